@@ -166,6 +166,7 @@ static int restore_tty;
 
 #if HAVE_THREADS
 static void free_input_threads(void);
+static void free_encoder_thread(OutputStream *ost);
 #endif
 
 /* sub2video hack:
@@ -563,6 +564,9 @@ static void ffmpeg_cleanup(int ret)
         if (!ost)
             continue;
 
+#if HAVE_THREADS
+        free_encoder_thread(ost);
+#endif
         av_bsf_free(&ost->bsf_ctx);
 
         av_frame_free(&ost->filtered_frame);
@@ -625,6 +629,7 @@ static void ffmpeg_cleanup(int ret)
                    av_err2str(AVERROR(errno)));
     }
     av_freep(&vstats_filename);
+    av_freep(&filter_thread_type);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -668,27 +673,47 @@ static void abort_codec_experimental(AVCodec *c, int encoder)
     exit_program(1);
 }
 
+static void log_benchmark(BenchmarkTimeStamps *last, const char *fmt, va_list va)
+{
+    BenchmarkTimeStamps t = get_benchmark_time_stamps();
+    char buf[1024];
+
+    if (fmt) {
+        vsnprintf(buf, sizeof(buf), fmt, va);
+        av_log(NULL, AV_LOG_INFO,
+               "bench: %8" PRIu64 " user %8" PRIu64 " sys %8" PRIu64 " real %s \n",
+               t.user_usec - last->user_usec,
+               t.sys_usec - last->sys_usec,
+               t.real_usec - last->real_usec, buf);
+    }
+    *last = t;
+}
+
 static void update_benchmark(const char *fmt, ...)
 {
     if (do_benchmark_all) {
-        BenchmarkTimeStamps t = get_benchmark_time_stamps();
         va_list va;
-        char buf[1024];
 
-        if (fmt) {
-            va_start(va, fmt);
-            vsnprintf(buf, sizeof(buf), fmt, va);
-            va_end(va);
-            av_log(NULL, AV_LOG_INFO,
-                   "bench: %8" PRIu64 " user %8" PRIu64 " sys %8" PRIu64 " real %s \n",
-                   t.user_usec - current_time.user_usec,
-                   t.sys_usec - current_time.sys_usec,
-                   t.real_usec - current_time.real_usec, buf);
-        }
-        current_time = t;
+        va_start(va, fmt);
+        log_benchmark(&current_time, fmt, va);
+        va_end(va);
     }
 }
 
+#if HAVE_THREADS
+/* same as update_benchmark() for the time stamps of another thread */
+static void update_thread_benchmark(BenchmarkTimeStamps *last, const char *fmt, ...)
+{
+    if (do_benchmark_all) {
+        va_list va;
+
+        va_start(va, fmt);
+        log_benchmark(last, fmt, va);
+        va_end(va);
+    }
+}
+#endif
+
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
@@ -896,6 +921,216 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
+#if HAVE_THREADS
+#define ENC_FRAME_QUEUE_SIZE   8
+#define ENC_PACKET_QUEUE_SIZE 64
+
+typedef struct EncoderPacket {
+    AVPacket pkt;
+    char *stats_out;    /* two-pass statistics as they were after this packet */
+} EncoderPacket;
+
+static void free_encoder_frame(void *msg)
+{
+    av_frame_free((AVFrame **)msg);
+}
+
+static void free_encoder_packet(void *msg)
+{
+    EncoderPacket *epkt = msg;
+    av_packet_unref(&epkt->pkt);
+    av_freep(&epkt->stats_out);
+}
+
+/*
+ * Runs the encoder of a single output stream. Frames arrive through
+ * enc_frame_queue (a NULL frame starts flushing), packets are returned
+ * through enc_packet_queue and are post-processed and muxed by the main
+ * thread. The bounded frame queue throttles the main thread when the
+ * encoder cannot keep up.
+ */
+static void *encoder_thread(void *arg)
+{
+    OutputStream   *ost = arg;
+    AVCodecContext *enc = ost->enc_ctx;
+    const char    *desc = av_get_media_type_string(enc->codec_type);
+    int64_t last_pts = AV_NOPTS_VALUE;
+    BenchmarkTimeStamps bench = { 0 };
+    int ret;
+
+    while (1) {
+        AVFrame *frame;
+        int flush;
+
+        ret = av_thread_message_queue_recv(ost->enc_frame_queue, &frame, 0);
+        if (ret < 0)
+            break;
+        flush = !frame;
+        if (frame)
+            last_pts = frame->pts;
+        /* the encoding is timed here, the main thread only sees the queues;
+         * user and sys times are still those of the whole process */
+        update_thread_benchmark(&bench, NULL);
+        ret = avcodec_send_frame(enc, frame);
+        av_frame_free(&frame);
+        if (ret < 0)
+            break;
+
+        while (1) {
+            EncoderPacket epkt = { .stats_out = NULL };
+
+            av_init_packet(&epkt.pkt);
+            epkt.pkt.data = NULL;
+            epkt.pkt.size = 0;
+
+            ret = avcodec_receive_packet(enc, &epkt.pkt);
+            if (ret < 0)
+                break;
+
+            /* the main thread no longer knows which frame was just sent */
+            if (epkt.pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
+                epkt.pkt.pts = last_pts;
+            if (enc->stats_out && !(epkt.stats_out = av_strdup(enc->stats_out)))
+                ret = AVERROR(ENOMEM);
+            if (ret >= 0)
+                ret = av_thread_message_queue_send(ost->enc_packet_queue, &epkt, 0);
+            if (ret < 0) {
+                free_encoder_packet(&epkt);
+                break;
+            }
+        }
+        update_thread_benchmark(&bench, "%s_%s %d.%d", flush ? "flush" : "encode",
+                                desc, ost->file_index, ost->index);
+        if (ret != AVERROR(EAGAIN))
+            break;
+    }
+
+    if (ret < 0 && ret != AVERROR_EOF)
+        av_log(NULL, AV_LOG_ERROR, "Encoder thread for output stream #%d:%d failed: %s\n",
+               ost->file_index, ost->index, av_err2str(ret));
+    av_thread_message_queue_set_err_send(ost->enc_frame_queue, ret);
+    av_thread_message_queue_set_err_recv(ost->enc_packet_queue, ret);
+
+    return NULL;
+}
+
+static void free_encoder_thread(OutputStream *ost)
+{
+    AVFrame *frame;
+    EncoderPacket epkt;
+
+    if (!ost->enc_frame_queue)
+        return;
+
+    av_thread_message_queue_set_err_recv(ost->enc_frame_queue, AVERROR_EOF);
+    while (av_thread_message_queue_recv(ost->enc_frame_queue, &frame, AV_THREAD_MESSAGE_NONBLOCK) >= 0)
+        av_frame_free(&frame);
+    av_thread_message_queue_set_err_send(ost->enc_packet_queue, AVERROR_EOF);
+    while (av_thread_message_queue_recv(ost->enc_packet_queue, &epkt, AV_THREAD_MESSAGE_NONBLOCK) >= 0)
+        free_encoder_packet(&epkt);
+
+    pthread_join(ost->enc_thread, NULL);
+    av_thread_message_queue_free(&ost->enc_frame_queue);
+    av_thread_message_queue_free(&ost->enc_packet_queue);
+    av_freep(&ost->enc_stats_out);
+}
+
+static int init_encoder_thread(OutputStream *ost)
+{
+    int ret;
+
+    ret = av_thread_message_queue_alloc(&ost->enc_frame_queue,
+                                        ENC_FRAME_QUEUE_SIZE, sizeof(AVFrame *));
+    if (ret < 0)
+        return ret;
+    ret = av_thread_message_queue_alloc(&ost->enc_packet_queue,
+                                        ENC_PACKET_QUEUE_SIZE, sizeof(EncoderPacket));
+    if (ret < 0) {
+        av_thread_message_queue_free(&ost->enc_frame_queue);
+        return ret;
+    }
+    av_thread_message_queue_set_free_func(ost->enc_frame_queue, free_encoder_frame);
+    av_thread_message_queue_set_free_func(ost->enc_packet_queue, free_encoder_packet);
+
+    if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&ost->enc_frame_queue);
+        av_thread_message_queue_free(&ost->enc_packet_queue);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+#endif
+
+/*
+ * Wrappers around avcodec_send_frame()/avcodec_receive_packet() which hand
+ * the work to the encoder thread of the stream when -pipeline_encoders is
+ * in use. If block is set, wait for the encoder thread to return a packet
+ * instead of failing with EAGAIN; this is only valid once the encoder is
+ * being flushed.
+ */
+static int encoder_send_frame(OutputStream *ost, const AVFrame *frame)
+{
+#if HAVE_THREADS
+    if (ost->enc_frame_queue) {
+        AVFrame *clone = NULL;
+        int ret;
+
+        if (frame && !(clone = av_frame_clone(frame)))
+            return AVERROR(ENOMEM);
+        ret = av_thread_message_queue_send(ost->enc_frame_queue, &clone, 0);
+        if (ret < 0)
+            av_frame_free(&clone);
+        return ret;
+    }
+#endif
+    return avcodec_send_frame(ost->enc_ctx, frame);
+}
+
+static int encoder_receive_packet(OutputStream *ost, AVPacket *pkt, int block)
+{
+#if HAVE_THREADS
+    if (ost->enc_packet_queue) {
+        EncoderPacket epkt;
+        int ret;
+
+        av_freep(&ost->enc_stats_out);
+        ret = av_thread_message_queue_recv(ost->enc_packet_queue, &epkt,
+                                           block ? 0 : AV_THREAD_MESSAGE_NONBLOCK);
+        if (ret < 0) {
+            /* the encoder thread is done with the codec context */
+            if (ret != AVERROR(EAGAIN))
+                free_encoder_thread(ost);
+            return ret;
+        }
+        *pkt               = epkt.pkt;
+        ost->enc_stats_out = epkt.stats_out;
+        return 0;
+    }
+#endif
+    return avcodec_receive_packet(ost->enc_ctx, pkt);
+}
+
+/* the encoder runs in its own thread, which also takes the benchmarks */
+static int encoder_pipelined(OutputStream *ost)
+{
+#if HAVE_THREADS
+    return !!ost->enc_frame_queue;
+#else
+    return 0;
+#endif
+}
+
+static const char *encoder_stats_out(OutputStream *ost)
+{
+#if HAVE_THREADS
+    if (ost->enc_packet_queue)
+        return ost->enc_stats_out;
+#endif
+    return ost->enc_ctx->stats_out;
+}
+
 static void do_audio_out(OutputFile *of, OutputStream *ost,
                          AVFrame *frame)
 {
@@ -925,18 +1160,19 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
-    ret = avcodec_send_frame(enc, frame);
+    ret = encoder_send_frame(ost, frame);
     if (ret < 0)
         goto error;
 
     while (1) {
-        ret = avcodec_receive_packet(enc, &pkt);
+        ret = encoder_receive_packet(ost, &pkt, 0);
         if (ret == AVERROR(EAGAIN))
             break;
         if (ret < 0)
             goto error;
 
-        update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
+        if (!encoder_pipelined(ost))
+            update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
 
         av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
 
@@ -1274,15 +1510,18 @@ static void do_video_out(OutputFile *of,
 
         ost->frames_encoded++;
 
-        ret = avcodec_send_frame(enc, in_picture);
+        ret = encoder_send_frame(ost, in_picture);
         if (ret < 0)
             goto error;
         // Make sure Closed Captions will not be duplicated
         av_frame_remove_side_data(in_picture, AV_FRAME_DATA_A53_CC);
+        // Motion vectors do not apply to the duplicates of a frame
+        av_frame_remove_side_data(in_picture, AV_FRAME_DATA_MOTION_VECTORS);
 
         while (1) {
-            ret = avcodec_receive_packet(enc, &pkt);
-            update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
+            ret = encoder_receive_packet(ost, &pkt, 0);
+            if (!encoder_pipelined(ost))
+                update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
             if (ret == AVERROR(EAGAIN))
                 break;
             if (ret < 0)
@@ -1311,8 +1550,8 @@ static void do_video_out(OutputFile *of,
             output_packet(of, &pkt, ost, 0);
 
             /* if two pass, output log */
-            if (ost->logfile && enc->stats_out) {
-                fprintf(ost->logfile, "%s", enc->stats_out);
+            if (ost->logfile && encoder_stats_out(ost)) {
+                fprintf(ost->logfile, "%s", encoder_stats_out(ost));
             }
         }
         ost->sync_opts++;
@@ -1896,8 +2135,20 @@ static void flush_encoders(void)
         if (enc->codec_type != AVMEDIA_TYPE_VIDEO && enc->codec_type != AVMEDIA_TYPE_AUDIO)
             continue;
 
+#if HAVE_THREADS
+        if (ost->enc_frame_queue) {
+            ret = encoder_send_frame(ost, NULL);
+            if (ret < 0) {
+                av_log(NULL, AV_LOG_FATAL, "Flushing the encoder thread failed: %s\n",
+                       av_err2str(ret));
+                exit_program(1);
+            }
+        }
+#endif
+
         for (;;) {
             const char *desc = NULL;
+            int pipelined = encoder_pipelined(ost);
             AVPacket pkt;
             int pkt_size;
 
@@ -1918,7 +2169,7 @@ static void flush_encoders(void)
 
             update_benchmark(NULL);
 
-            while ((ret = avcodec_receive_packet(enc, &pkt)) == AVERROR(EAGAIN)) {
+            while ((ret = encoder_receive_packet(ost, &pkt, 1)) == AVERROR(EAGAIN)) {
                 ret = avcodec_send_frame(enc, NULL);
                 if (ret < 0) {
                     av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
@@ -1928,15 +2179,16 @@ static void flush_encoders(void)
                 }
             }
 
-            update_benchmark("flush_%s %d.%d", desc, ost->file_index, ost->index);
+            if (!pipelined)
+                update_benchmark("flush_%s %d.%d", desc, ost->file_index, ost->index);
             if (ret < 0 && ret != AVERROR_EOF) {
                 av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
                        desc,
                        av_err2str(ret));
                 exit_program(1);
             }
-            if (ost->logfile && enc->stats_out) {
-                fprintf(ost->logfile, "%s", enc->stats_out);
+            if (ost->logfile && encoder_stats_out(ost)) {
+                fprintf(ost->logfile, "%s", encoder_stats_out(ost));
             }
             if (ret == AVERROR_EOF) {
                 output_packet(of, &pkt, ost, 1);
@@ -3550,6 +3802,16 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
             ost->st->duration = av_rescale_q(ist->st->duration, ist->st->time_base, ost->st->time_base);
 
         ost->st->codec->codec= ost->enc_ctx->codec;
+
+#if HAVE_THREADS
+        if (pipeline_encoders &&
+            (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO ||
+             ost->enc_ctx->codec_type == AVMEDIA_TYPE_AUDIO)) {
+            ret = init_encoder_thread(ost);
+            if (ret < 0)
+                return ret;
+        }
+#endif
     } else if (ost->stream_copy) {
         ret = init_output_stream_streamcopy(ost);
         if (ret < 0)
@@ -549,6 +549,14 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+#if HAVE_THREADS
+    /* encoder thread, see -pipeline_encoders */
+    AVThreadMessageQueue *enc_frame_queue;  /* frames to encode */
+    AVThreadMessageQueue *enc_packet_queue; /* encoded packets */
+    pthread_t enc_thread;
+    char *enc_stats_out;                    /* two-pass stats for the last packet */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -609,6 +617,8 @@ extern char *videotoolbox_pixfmt;
 
 extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern char *filter_thread_type;
+extern int pipeline_encoders;
 extern int vstats_version;
 
 extern const AVIOInterruptCB int_cb;
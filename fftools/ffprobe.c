@@ -36,6 +36,7 @@
 #include "libavutil/display.h"
 #include "libavutil/hash.h"
 #include "libavutil/mastering_display_metadata.h"
+#include "libavutil/motion_vector.h"
 #include "libavutil/dovi_meta.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
@@ -102,6 +103,7 @@ static int do_show_pixel_formats = 0;
 static int do_show_pixel_format_flags = 0;
 static int do_show_pixel_format_components = 0;
 static int do_show_log = 0;
+static int do_show_frame_motion_vectors = 0;
 
 static int do_show_chapter_tags = 0;
 static int do_show_format_tags = 0;
@@ -170,6 +172,8 @@ typedef enum {
     SECTION_ID_FRAME_SIDE_DATA_TIMECODE,
     SECTION_ID_FRAME_LOG,
     SECTION_ID_FRAME_LOGS,
+    SECTION_ID_FRAME_MOTION_VECTOR,
+    SECTION_ID_FRAME_MOTION_VECTORS,
     SECTION_ID_LIBRARY_VERSION,
     SECTION_ID_LIBRARY_VERSIONS,
     SECTION_ID_PACKET,
@@ -209,7 +213,7 @@ static struct section sections[] = {
     [SECTION_ID_FORMAT] =             { SECTION_ID_FORMAT, "format", 0, { SECTION_ID_FORMAT_TAGS, -1 } },
     [SECTION_ID_FORMAT_TAGS] =        { SECTION_ID_FORMAT_TAGS, "tags", SECTION_FLAG_HAS_VARIABLE_FIELDS, { -1 }, .element_name = "tag", .unique_name = "format_tags" },
     [SECTION_ID_FRAMES] =             { SECTION_ID_FRAMES, "frames", SECTION_FLAG_IS_ARRAY, { SECTION_ID_FRAME, SECTION_ID_SUBTITLE, -1 } },
-    [SECTION_ID_FRAME] =              { SECTION_ID_FRAME, "frame", 0, { SECTION_ID_FRAME_TAGS, SECTION_ID_FRAME_SIDE_DATA_LIST, SECTION_ID_FRAME_LOGS, -1 } },
+    [SECTION_ID_FRAME] =              { SECTION_ID_FRAME, "frame", 0, { SECTION_ID_FRAME_TAGS, SECTION_ID_FRAME_SIDE_DATA_LIST, SECTION_ID_FRAME_LOGS, SECTION_ID_FRAME_MOTION_VECTORS, -1 } },
     [SECTION_ID_FRAME_TAGS] =         { SECTION_ID_FRAME_TAGS, "tags", SECTION_FLAG_HAS_VARIABLE_FIELDS, { -1 }, .element_name = "tag", .unique_name = "frame_tags" },
     [SECTION_ID_FRAME_SIDE_DATA_LIST] ={ SECTION_ID_FRAME_SIDE_DATA_LIST, "side_data_list", SECTION_FLAG_IS_ARRAY, { SECTION_ID_FRAME_SIDE_DATA, -1 }, .element_name = "side_data", .unique_name = "frame_side_data_list" },
     [SECTION_ID_FRAME_SIDE_DATA] =     { SECTION_ID_FRAME_SIDE_DATA, "side_data", 0, { SECTION_ID_FRAME_SIDE_DATA_TIMECODE_LIST, -1 } },
@@ -217,6 +221,8 @@ static struct section sections[] = {
     [SECTION_ID_FRAME_SIDE_DATA_TIMECODE] =     { SECTION_ID_FRAME_SIDE_DATA_TIMECODE, "timecode", 0, { -1 } },
     [SECTION_ID_FRAME_LOGS] =         { SECTION_ID_FRAME_LOGS, "logs", SECTION_FLAG_IS_ARRAY, { SECTION_ID_FRAME_LOG, -1 } },
     [SECTION_ID_FRAME_LOG] =          { SECTION_ID_FRAME_LOG, "log", 0, { -1 },  },
+    [SECTION_ID_FRAME_MOTION_VECTORS] = { SECTION_ID_FRAME_MOTION_VECTORS, "motion_vectors", SECTION_FLAG_IS_ARRAY, { SECTION_ID_FRAME_MOTION_VECTOR, -1 } },
+    [SECTION_ID_FRAME_MOTION_VECTOR] =  { SECTION_ID_FRAME_MOTION_VECTOR, "motion_vector", 0, { -1 } },
     [SECTION_ID_LIBRARY_VERSIONS] =   { SECTION_ID_LIBRARY_VERSIONS, "library_versions", SECTION_FLAG_IS_ARRAY, { SECTION_ID_LIBRARY_VERSION, -1 } },
     [SECTION_ID_LIBRARY_VERSION] =    { SECTION_ID_LIBRARY_VERSION, "library_version", 0, { -1 } },
     [SECTION_ID_PACKETS] =            { SECTION_ID_PACKETS, "packets", SECTION_FLAG_IS_ARRAY, { SECTION_ID_PACKET, -1} },
@@ -2125,6 +2131,54 @@ static void show_subtitle(WriterContext *w, AVSubtitle *sub, AVStream *stream,
     fflush(stdout);
 }
 
+static void show_motion_vectors(WriterContext *w, const AVFrameSideData *sd)
+{
+    const AVMotionVectorExt *ext = NULL;
+    size_t mv_size = sizeof(AVMotionVector);
+    int i, nb_mvs;
+
+    /* the extended vectors are read with the size of their first entry */
+    if (sd->type == AV_FRAME_DATA_MOTION_VECTORS_EXT) {
+        mv_size = ((const AVMotionVectorExt *)sd->data)->self_size;
+        if (mv_size < sizeof(*ext))
+            return;
+    }
+    nb_mvs = sd->size / mv_size;
+
+    writer_print_section_header(w, SECTION_ID_FRAME_MOTION_VECTORS);
+    for (i = 0; i < nb_mvs; i++) {
+        const AVMotionVector *mv = (const AVMotionVector *)(sd->data + i * mv_size);
+
+        if (sd->type == AV_FRAME_DATA_MOTION_VECTORS_EXT) {
+            ext = (const AVMotionVectorExt *)mv;
+            mv  = &ext->mv;
+        }
+
+        writer_print_section_header(w, SECTION_ID_FRAME_MOTION_VECTOR);
+        print_int("source",       mv->source);
+        print_int("w",            mv->w);
+        print_int("h",            mv->h);
+        print_int("src_x",        mv->src_x);
+        print_int("src_y",        mv->src_y);
+        print_int("dst_x",        mv->dst_x);
+        print_int("dst_y",        mv->dst_y);
+        print_int("flags",        mv->flags);
+        print_int("motion_x",     mv->motion_x);
+        print_int("motion_y",     mv->motion_y);
+        print_int("motion_scale", mv->motion_scale);
+        if (ext) {
+            print_int("ref_idx",   ext->ref_idx);
+            if (ext->poc_delta != INT32_MIN)
+                print_int("poc_delta", ext->poc_delta);
+            else
+                print_str_opt("poc_delta", "N/A");
+            print_int("list",      ext->list);
+        }
+        writer_print_section_footer(w);
+    }
+    writer_print_section_footer(w);
+}
+
 static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
                        AVFormatContext *fmt_ctx)
 {
@@ -2203,6 +2257,13 @@ static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
         show_tags(w, frame->metadata, SECTION_ID_FRAME_TAGS);
     if (do_show_log)
         show_log(w, SECTION_ID_FRAME_LOGS, SECTION_ID_FRAME_LOG, do_show_log);
+    if (do_show_frame_motion_vectors) {
+        AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS_EXT);
+        if (!sd || sd->size < sizeof(AVMotionVectorExt))
+            sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+        if (sd)
+            show_motion_vectors(w, sd);
+    }
     if (frame->nb_side_data) {
         writer_print_section_header(w, SECTION_ID_FRAME_SIDE_DATA_LIST);
         for (i = 0; i < frame->nb_side_data; i++) {
@@ -2949,6 +3010,9 @@ static int open_input_file(InputFile *ifile, const char *filename,
                 av_dict_set(&codec_opts, "threads", "1", 0);
             }
 
+            if (do_show_frame_motion_vectors)
+                ist->dec_ctx->flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+
             ist->dec_ctx->pkt_timebase = stream->time_base;
             ist->dec_ctx->framerate = stream->avg_frame_rate;
 #if FF_API_LAVF_AVCTX
@@ -3520,6 +3584,7 @@ DEFINE_OPT_SHOW_SECTION(error,            ERROR)
 DEFINE_OPT_SHOW_SECTION(format,           FORMAT)
 DEFINE_OPT_SHOW_SECTION(frames,           FRAMES)
 DEFINE_OPT_SHOW_SECTION(library_versions, LIBRARY_VERSIONS)
+DEFINE_OPT_SHOW_SECTION(motion_vectors,   FRAME_MOTION_VECTORS)
 DEFINE_OPT_SHOW_SECTION(packets,          PACKETS)
 DEFINE_OPT_SHOW_SECTION(pixel_formats,    PIXEL_FORMATS)
 DEFINE_OPT_SHOW_SECTION(program_version,  PROGRAM_VERSION)
@@ -3554,6 +3619,7 @@ static const OptionDef real_options[] = {
 #if HAVE_THREADS
     { "show_log", OPT_INT|HAS_ARG, { &do_show_log }, "show log" },
 #endif
+    { "show_motion_vectors", 0, { .func_arg = &opt_show_motion_vectors }, "show the motion vectors of the frames" },
     { "show_packets", 0, { .func_arg = &opt_show_packets }, "show packets info" },
     { "show_programs", 0, { .func_arg = &opt_show_programs }, "show programs info" },
     { "show_streams", 0, { .func_arg = &opt_show_streams }, "show streams info" },
@@ -3631,6 +3697,7 @@ int main(int argc, char **argv)
     SET_DO_SHOW(ERROR, error);
     SET_DO_SHOW(FORMAT, format);
     SET_DO_SHOW(FRAMES, frames);
+    SET_DO_SHOW(FRAME_MOTION_VECTORS, frame_motion_vectors);
     SET_DO_SHOW(LIBRARY_VERSIONS, library_versions);
     SET_DO_SHOW(PACKETS, packets);
     SET_DO_SHOW(PIXEL_FORMATS, pixel_formats);
@@ -374,6 +374,13 @@ typedef struct RcOverride{
  * Show all frames before the first keyframe
  */
 #define AV_CODEC_FLAG2_SHOW_ALL       (1 << 22)
+/**
+ * Parse motion information and export it through frame side data, but skip
+ * pixel reconstruction (motion compensation, residual, loop filtering).
+ * Implies AV_CODEC_EXPORT_DATA_MVS. The content of the returned picture
+ * planes is undefined; only the side data is meaningful.
+ */
+#define AV_CODEC_FLAG2_MVS_ONLY       (1 << 27)
 /**
  * Export motion vectors through frame side data
  */
@@ -410,6 +417,18 @@ typedef struct RcOverride{
  * Export the AVVideoEncParams structure through frame side data.
  */
 #define AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS (1 << 2)
+/**
+ * Decoding only.
+ * Export motion vectors through frame side data, in the compact layout
+ * described by AVMotionVectorsCompact.
+ */
+#define AV_CODEC_EXPORT_DATA_MVS_COMPACT (1 << 3)
+/**
+ * Decoding only.
+ * Export motion vectors through frame side data together with the identity
+ * of their reference, as AVMotionVectorExt.
+ */
+#define AV_CODEC_EXPORT_DATA_MVS_EXT     (1 << 4)
 
 /**
  * Pan Scan area.
@@ -2352,6 +2371,17 @@ typedef struct AVCodecContext {
      * - encoding: set by user
      */
     int export_side_data;
+
+    /**
+     * Number of slice threads to run inside each frame thread, for decoders
+     * that support combining frame and slice threading. Only used when both
+     * FF_THREAD_FRAME and FF_THREAD_SLICE are set in thread_type and frame
+     * threading is active; 0 or 1 disables nested slice threading.
+     *
+     * - decoding: set by user
+     * - encoding: unused
+     */
+    int slice_thread_count;
 } AVCodecContext;
 
 #if FF_API_CODEC_GET_SET
@@ -19,22 +19,24 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "libavutil/common.h"
 #include "libavutil/frame.h"
-#include "libavutil/pixdesc.h"
 #include "libavutil/motion_vector.h"
-#include "libavutil/avassert.h"
+#include "libavutil/video_enc_params.h"
 
 #include "avcodec.h"
+#include "internal.h"
 #include "mpegutils.h"
 #include "mpegvideo.h"
+#include "thread.h"
 #include "get_mvs.h"
 
-static int add_mb(AVMotionVector *mb, uint32_t mb_type,
-                  int dst_x, int dst_y,
-                  int motion_x, int motion_y, int motion_scale,
-                  int direction)
+static void add_mb(AVMotionVector *mb, uint32_t mb_type,
+                   int dst_x, int dst_y,
+                   int motion_x, int motion_y, int motion_scale,
+                   int direction, int flags)
 {
     mb->w = IS_8X8(mb_type) || IS_8X16(mb_type) ? 8 : 16;
     mb->h = IS_8X8(mb_type) || IS_16X8(mb_type) ? 8 : 16;
@@ -46,722 +48,458 @@ static int add_mb(AVMotionVector *mb, uint32_t mb_type,
     mb->src_x = dst_x + motion_x / motion_scale;
     mb->src_y = dst_y + motion_y / motion_scale;
     mb->source = direction ? 1 : -1;
-    mb->flags = 0; // XXX: does mb_type contain extra information that could be exported here?
-    return 1;
+    mb->flags = flags;
 }
 
+static AVBufferRef *get_pool_buffer(AVBufferPool **pool, int *pool_size,
+                                    int max_count, size_t elem_size)
+{
+    int size;
+
+    if (max_count <= 0 || max_count > INT_MAX / elem_size)
+        return NULL;
+    size = max_count * elem_size;
+
+    if (!*pool || *pool_size != size) {
+        av_buffer_pool_uninit(pool);
+        *pool_size = 0;
+        *pool      = av_buffer_pool_init(size, NULL);
+        if (!*pool)
+            return NULL;
+        *pool_size = size;
+    }
+
+    return av_buffer_pool_get(*pool);
+}
 
-void set_motion_vector_core(AVCodecContext *avctx, AVFrame *pict, uint8_t *mbskip_table,
-                         uint32_t *mbtype_table, int8_t *qscale_table, int16_t (*motion_val[2])[2],
-                         int *low_delay,
-                         int mb_width, int mb_height, int mb_stride, int quarter_sample, enum AVCodecID id)
+AVBufferRef *ff_get_mvs_buffer(AVCodecContext *avctx, int max_count)
 {
-    if ((avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS) && mbtype_table && motion_val[0]) {
-        const int shift = 1 + quarter_sample;
-        const int scale = 1 << shift;
-        const int mv_sample_log2 = avctx->codec_id == AV_CODEC_ID_H264 || avctx->codec_id == AV_CODEC_ID_SVQ3 ? 2 : 1;
-        const int mv_stride      = (mb_width << mv_sample_log2) +
-                                   (avctx->codec->id == AV_CODEC_ID_H264 ? 0 : 1);
-        int mb_x, mb_y, mbcount = 0;
-
-        /* size is width * height * 2 * 4 where 2 is for directions and 4 is
-         * for the maximum number of MB (4 MB in case of IS_8x8) */
-        AVMotionVector *mvs = av_malloc_array(mb_width * mb_height, 2 * 4 * sizeof(AVMotionVector));
-        if (!mvs) {
-            av_log(NULL, AV_LOG_ERROR, "mvs is NULL\n");
-            return;
-        }
+    AVCodecInternal *avci = avctx->internal;
 
-        for (mb_y = 0; mb_y < mb_height; mb_y++) {
-            for (mb_x = 0; mb_x < mb_width; mb_x++) {
-                int i, direction, mb_type = mbtype_table[mb_x + mb_y * mb_stride];
-                for (direction = 0; direction < 2; direction++) {
-                    if ( id != AV_CODEC_ID_VC1 && (!USES_LIST(mb_type, direction))) {
-                        av_log(NULL, AV_LOG_ERROR, "continue\n");
-                        continue;
-                    }
-                    if (IS_8X8(mb_type)) {
-                        for (i = 0; i < 4; i++) {
-                            int sx = mb_x * 16 + 4 + 8 * (i & 1);
-                            int sy = mb_y * 16 + 4 + 8 * (i >> 1);
-                            int xy = (mb_x * 2 + (i & 1) +
-                                      (mb_y * 2 + (i >> 1)) * mv_stride) << (mv_sample_log2 - 1);
-                            int mx = motion_val[direction][xy][0];
-                            int my = motion_val[direction][xy][1];
-                            mbcount += add_mb(mvs + mbcount, mb_type, sx, sy, mx, my, scale, direction);
-                        }
-                    } else if (IS_16X8(mb_type)) {
-                        for (i = 0; i < 2; i++) {
-                            int sx = mb_x * 16 + 8;
-                            int sy = mb_y * 16 + 4 + 8 * i;
-                            int xy = (mb_x * 2 + (mb_y * 2 + i) * mv_stride) << (mv_sample_log2 - 1);
-                            int mx = motion_val[direction][xy][0];
-                            int my = motion_val[direction][xy][1];
-
-                            if (IS_INTERLACED(mb_type))
-                                my *= 2;
-
-                            mbcount += add_mb(mvs + mbcount, mb_type, sx, sy, mx, my, scale, direction);
-                        }
-                    } else if (IS_8X16(mb_type)) {
-                        for (i = 0; i < 2; i++) {
-                            int sx = mb_x * 16 + 4 + 8 * i;
-                            int sy = mb_y * 16 + 8;
-                            int xy = (mb_x * 2 + i + mb_y * 2 * mv_stride) << (mv_sample_log2 - 1);
-                            int mx = motion_val[direction][xy][0];
-                            int my = motion_val[direction][xy][1];
-
-                            if (IS_INTERLACED(mb_type))
-                                my *= 2;
-
-                            mbcount += add_mb(mvs + mbcount, mb_type, sx, sy, mx, my, scale, direction);
-                        }
-                    } else {
-                          int sx = mb_x * 16 + 8;
-                          int sy = mb_y * 16 + 8;
-                          int xy = (mb_x + mb_y * mv_stride) << mv_sample_log2;
-                          int mx = motion_val[direction][xy][0];
-                          int my = motion_val[direction][xy][1];
-                          mbcount += add_mb(mvs + mbcount, mb_type, sx, sy, mx, my, scale, direction);
-                    }
-                }
-            }
-        }
+    return get_pool_buffer(&avci->mvs_pool, &avci->mvs_pool_size,
+                           max_count, sizeof(AVMotionVector));
+}
 
-        if (mbcount) {
-            AVFrameSideData *sd;
+AVBufferRef *ff_get_mvs_ext_buffer(AVCodecContext *avctx, int max_count)
+{
+    AVCodecInternal *avci = avctx->internal;
 
-            av_log(avctx, AV_LOG_DEBUG, "Adding %d MVs info to frame %d\n", mbcount, avctx->frame_number);
-            sd = av_frame_new_side_data(pict, AV_FRAME_DATA_MOTION_VECTORS, mbcount * sizeof(AVMotionVector));
-            if (!sd) {
-                av_log(NULL, AV_LOG_ERROR, "av_frame_new_side_data failed.\n");
-                av_freep(&mvs);
-                return;
-            }
-            memcpy(sd->data, mvs, mbcount * sizeof(AVMotionVector));
-        }
+    return get_pool_buffer(&avci->mvs_ext_pool, &avci->mvs_ext_pool_size,
+                           max_count, sizeof(AVMotionVectorExt));
+}
 
-        av_freep(&mvs);
-    }
+static void unref_pool_buffer(void *opaque, uint8_t *data)
+{
+    AVBufferRef *buf = opaque;
+    av_buffer_unref(&buf);
+}
 
-    /* TODO: export all the following to make them accessible for users (and filters) */
-    if (avctx->hwaccel || !mbtype_table) {
-        av_log(NULL, AV_LOG_ERROR, "avctx->hwaccel || !mbtype_table\n");
-        return;
+int ff_attach_mvs_buffer(AVCodecContext *avctx, AVFrame *frame,
+                         enum AVFrameSideDataType type, AVBufferRef **pbuf, int size)
+{
+    AVBufferRef *buf = *pbuf, *used;
+
+    *pbuf = NULL;
+    if (!size) {
+        av_buffer_unref(&buf);
+        return 0;
     }
 
-    if (avctx->debug & (FF_DEBUG_SKIP | FF_DEBUG_QP | FF_DEBUG_MB_TYPE)) {
-        int x,y;
-
-        av_log(avctx, AV_LOG_DEBUG, "New frame, type: %c\n",
-               av_get_picture_type_char(pict->pict_type));
-        for (y = 0; y < mb_height; y++) {
-            for (x = 0; x < mb_width; x++) {
-                if (avctx->debug & FF_DEBUG_SKIP) {
-                    int count = mbskip_table ? mbskip_table[x + y * mb_stride] : 0;
-                    if (count > 9)
-                        count = 9;
-                    av_log(avctx, AV_LOG_DEBUG, "%1d", count);
-                }
-                if (avctx->debug & FF_DEBUG_QP) {
-                    av_log(avctx, AV_LOG_DEBUG, "%2d",
-                           qscale_table[x + y * mb_stride]);
-                }
-                if (avctx->debug & FF_DEBUG_MB_TYPE) {
-                    int mb_type = mbtype_table[x + y * mb_stride];
-                    // Type & MV direction
-                    if (IS_PCM(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "P");
-                    else if (IS_INTRA(mb_type) && IS_ACPRED(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "A");
-                    else if (IS_INTRA4x4(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "i");
-                    else if (IS_INTRA16x16(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "I");
-                    else if (IS_DIRECT(mb_type) && IS_SKIP(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "d");
-                    else if (IS_DIRECT(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "D");
-                    else if (IS_GMC(mb_type) && IS_SKIP(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "g");
-                    else if (IS_GMC(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "G");
-                    else if (IS_SKIP(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "S");
-                    else if (!USES_LIST(mb_type, 1))
-                        av_log(avctx, AV_LOG_DEBUG, ">");
-                    else if (!USES_LIST(mb_type, 0))
-                        av_log(avctx, AV_LOG_DEBUG, "<");
-                    else {
-                        av_assert2(USES_LIST(mb_type, 0) && USES_LIST(mb_type, 1));
-                        av_log(avctx, AV_LOG_DEBUG, "X");
-                    }
+    /* the side data and its copies must have the size of the vectors
+     * written, so wrap the used part of the pooled buffer, which returns to
+     * the pool once the last reference to that part is gone */
+    used = av_buffer_create(buf->data, size, unref_pool_buffer, buf, 0);
+    if (!used) {
+        av_buffer_unref(&buf);
+        goto fail;
+    }
+    if (!av_frame_new_side_data_from_buf(frame, type, used)) {
+        av_buffer_unref(&used);
+        goto fail;
+    }
+    return 0;
+fail:
+    av_log(avctx, AV_LOG_ERROR, "Could not attach motion vectors\n");
+    return AVERROR(ENOMEM);
+}
 
-                    // segmentation
-                    if (IS_8X8(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "+");
-                    else if (IS_16X8(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "-");
-                    else if (IS_8X16(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "|");
-                    else if (IS_INTRA(mb_type) || IS_16X16(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, " ");
-                    else
-                        av_log(avctx, AV_LOG_DEBUG, "?");
+/* maximum number of vectors a macroblock can produce: 2 lists of 4 blocks */
+#define MAX_MB_MVS 8
+#define MAX_JOBS   64
+
+typedef struct MVExportContext {
+    uint32_t *mbtype_table;
+    int16_t (**motion_val)[2];
+    int mb_width, mb_height, mb_stride;
+    int mv_sample_log2, mv_stride;
+    int scale;
+
+    int nb_jobs;
+    /* job n writes its vectors from the first row it handles on, at
+     * MAX_MB_MVS vectors per macroblock, and stores their number in
+     * count[n]; the regions are made contiguous afterwards */
+    AVMotionVector *mvs;
+    AVMotionVectorExt *mvs_ext;
+    int count[MAX_JOBS];
+
+    const MVRefInfo *refs;
+
+    AVMotionVectorsCompact *mvc;
+    int count_compact[MAX_JOBS];    ///< grid blocks written by each job
+} MVExportContext;
+
+/**
+ * Write vector n of the plain and/or extended arrays for 8x8 block blk of
+ * the macroblock.
+ * @return the number of vectors written, 0 if the block does not use the list
+ */
+static int add_mv(const MVExportContext *c, AVMotionVector *mvs,
+                  AVMotionVectorExt *mvs_ext, int n,
+                  uint32_t mb_type, int mb_xy, int blk,
+                  int dst_x, int dst_y, int motion_x, int motion_y,
+                  int direction)
+{
+    const MVRefInfo *refs = c->refs;
+    int ref = 0, flags = 0;
 
+    if (refs) {
+        ref = refs->ref_index[direction][4 * mb_xy + blk];
+        if (ref < 0)
+            return 0;
+        if (USES_LIST(mb_type, !direction) &&
+            refs->ref_index[!direction][4 * mb_xy + blk] >= 0)
+            flags |= AV_MOTION_VECTOR_FLAG_BIPRED;
+    } else if (USES_LIST(mb_type, !direction)) {
+        flags |= AV_MOTION_VECTOR_FLAG_BIPRED;
+    }
 
-                    if (IS_INTERLACED(mb_type))
-                        av_log(avctx, AV_LOG_DEBUG, "=");
-                    else
-                        av_log(avctx, AV_LOG_DEBUG, " ");
-                }
-            }
-            av_log(avctx, AV_LOG_DEBUG, "\n");
-        }
+    if (mvs)
+        add_mb(&mvs[n], mb_type, dst_x, dst_y, motion_x, motion_y,
+               c->scale, direction, flags);
+    if (mvs_ext) {
+        AVMotionVectorExt *ext = &mvs_ext[n];
+
+        add_mb(&ext->mv, mb_type, dst_x, dst_y, motion_x, motion_y,
+               c->scale, direction, flags);
+        ext->self_size = sizeof(*ext);
+        ext->ref_idx   = ref;
+        ext->poc_delta = refs && ref < refs->nb_refs[direction] ?
+                         refs->poc_delta[direction][ref] : INT32_MIN;
+        ext->list      = direction;
     }
+    return 1;
+}
 
-#if FF_API_DEBUG_MV
-    if ((avctx->debug & (FF_DEBUG_VIS_QP | FF_DEBUG_VIS_MB_TYPE)) ||
-        (avctx->debug_mv)) {
-        int mb_y;
-        int i, ret;
-        int h_chroma_shift, v_chroma_shift, block_height;
-        const int mv_sample_log2 = avctx->codec_id == AV_CODEC_ID_H264 || avctx->codec_id == AV_CODEC_ID_SVQ3 ? 2 : 1;
-        const int mv_stride      = (mb_width << mv_sample_log2) +
-                                   (avctx->codec->id == AV_CODEC_ID_H264 ? 0 : 1);
-
-        if (low_delay)
-            *low_delay = 0; // needed to see the vectors without trashing the buffers
-
-        ret = av_pix_fmt_get_chroma_sub_sample (avctx->pix_fmt, &h_chroma_shift, &v_chroma_shift);
-        if (ret)
-            return;
-
-        av_frame_make_writable(pict);
-
-        pict->opaque = NULL;
-        block_height = 16 >> v_chroma_shift;
-
-        for (mb_y = 0; mb_y < mb_height; mb_y++) {
-            int mb_x;
-            for (mb_x = 0; mb_x < mb_width; mb_x++) {
-                const int mb_index = mb_x + mb_y * mb_stride;
-                if ((avctx->debug & FF_DEBUG_VIS_QP)) {
-                    uint64_t c = (qscale_table[mb_index] * 128 / 31) *
-                                 0x0101010101010101ULL;
-                    int y;
-                    for (y = 0; y < block_height; y++) {
-                        *(uint64_t *)(pict->data[1] + 8 * mb_x +
-                                      (block_height * mb_y + y) *
-                                      pict->linesize[1]) = c;
-                        *(uint64_t *)(pict->data[2] + 8 * mb_x +
-                                      (block_height * mb_y + y) *
-                                      pict->linesize[2]) = c;
-                    }
+static int export_mb_row(const MVExportContext *c, AVMotionVector *mvs,
+                         AVMotionVectorExt *mvs_ext, int mb_y)
+{
+    const int mv_sample_log2 = c->mv_sample_log2;
+    const int mv_stride      = c->mv_stride;
+    int16_t (**motion_val)[2] = c->motion_val;
+    int mb_x, mbcount = 0;
+
+    for (mb_x = 0; mb_x < c->mb_width; mb_x++) {
+        int mb_xy = mb_x + mb_y * c->mb_stride;
+        int i, direction, mb_type = c->mbtype_table[mb_xy];
+        for (direction = 0; direction < 2; direction++) {
+            if (!USES_LIST(mb_type, direction))
+                continue;
+            if (IS_8X8(mb_type)) {
+                for (i = 0; i < 4; i++) {
+                    int sx = mb_x * 16 + 4 + 8 * (i & 1);
+                    int sy = mb_y * 16 + 4 + 8 * (i >> 1);
+                    int xy = (mb_x * 2 + (i & 1) +
+                              (mb_y * 2 + (i >> 1)) * mv_stride) << (mv_sample_log2 - 1);
+                    int mx = motion_val[direction][xy][0];
+                    int my = motion_val[direction][xy][1];
+                    mbcount += add_mv(c, mvs, mvs_ext, mbcount, mb_type, mb_xy, i,
+                                      sx, sy, mx, my, direction);
                 }
-                if ((avctx->debug & FF_DEBUG_VIS_MB_TYPE) &&
-                    motion_val[0]) {
-                    int mb_type = mbtype_table[mb_index];
-                    uint64_t u,v;
-                    int y;
-#define COLOR(theta, r) \
-    u = (int)(128 + r * cos(theta * M_PI / 180)); \
-    v = (int)(128 + r * sin(theta * M_PI / 180));
-
-
-                    u = v = 128;
-                    if (IS_PCM(mb_type)) {
-                        COLOR(120, 48)
-                    } else if ((IS_INTRA(mb_type) && IS_ACPRED(mb_type)) ||
-                               IS_INTRA16x16(mb_type)) {
-                        COLOR(30, 48)
-                    } else if (IS_INTRA4x4(mb_type)) {
-                        COLOR(90, 48)
-                    } else if (IS_DIRECT(mb_type) && IS_SKIP(mb_type)) {
-                        // COLOR(120, 48)
-                    } else if (IS_DIRECT(mb_type)) {
-                        COLOR(150, 48)
-                    } else if (IS_GMC(mb_type) && IS_SKIP(mb_type)) {
-                        COLOR(170, 48)
-                    } else if (IS_GMC(mb_type)) {
-                        COLOR(190, 48)
-                    } else if (IS_SKIP(mb_type)) {
-                        // COLOR(180, 48)
-                    } else if (!USES_LIST(mb_type, 1)) {
-                        COLOR(240, 48)
-                    } else if (!USES_LIST(mb_type, 0)) {
-                        COLOR(0, 48)
-                    } else {
-                        av_assert2(USES_LIST(mb_type, 0) && USES_LIST(mb_type, 1));
-                        COLOR(300,48)
-                    }
+            } else if (IS_16X8(mb_type)) {
+                for (i = 0; i < 2; i++) {
+                    int sx = mb_x * 16 + 8;
+                    int sy = mb_y * 16 + 4 + 8 * i;
+                    int xy = (mb_x * 2 + (mb_y * 2 + i) * mv_stride) << (mv_sample_log2 - 1);
+                    int mx = motion_val[direction][xy][0];
+                    int my = motion_val[direction][xy][1];
 
-                    u *= 0x0101010101010101ULL;
-                    v *= 0x0101010101010101ULL;
-                    for (y = 0; y < block_height; y++) {
-                        *(uint64_t *)(pict->data[1] + 8 * mb_x +
-                                      (block_height * mb_y + y) * pict->linesize[1]) = u;
-                        *(uint64_t *)(pict->data[2] + 8 * mb_x +
-                                      (block_height * mb_y + y) * pict->linesize[2]) = v;
-                    }
+                    if (IS_INTERLACED(mb_type))
+                        my *= 2;
 
-                    // segmentation
-                    if (IS_8X8(mb_type) || IS_16X8(mb_type)) {
-                        *(uint64_t *)(pict->data[0] + 16 * mb_x + 0 +
-                                      (16 * mb_y + 8) * pict->linesize[0]) ^= 0x8080808080808080ULL;
-                        *(uint64_t *)(pict->data[0] + 16 * mb_x + 8 +
-                                      (16 * mb_y + 8) * pict->linesize[0]) ^= 0x8080808080808080ULL;
-                    }
-                    if (IS_8X8(mb_type) || IS_8X16(mb_type)) {
-                        for (y = 0; y < 16; y++)
-                            pict->data[0][16 * mb_x + 8 + (16 * mb_y + y) *
-                                          pict->linesize[0]] ^= 0x80;
-                    }
-                    if (IS_8X8(mb_type) && mv_sample_log2 >= 2) {
-                        int dm = 1 << (mv_sample_log2 - 2);
-                        for (i = 0; i < 4; i++) {
-                            int sx = mb_x * 16 + 8 * (i & 1);
-                            int sy = mb_y * 16 + 8 * (i >> 1);
-                            int xy = (mb_x * 2 + (i & 1) +
-                                     (mb_y * 2 + (i >> 1)) * mv_stride) << (mv_sample_log2 - 1);
-                            // FIXME bidir
-                            int32_t *mv = (int32_t *) &motion_val[0][xy];
-                            if (mv[0] != mv[dm] ||
-                                mv[dm * mv_stride] != mv[dm * (mv_stride + 1)])
-                                for (y = 0; y < 8; y++)
-                                    pict->data[0][sx + 4 + (sy + y) * pict->linesize[0]] ^= 0x80;
-                            if (mv[0] != mv[dm * mv_stride] || mv[dm] != mv[dm * (mv_stride + 1)])
-                                *(uint64_t *)(pict->data[0] + sx + (sy + 4) *
-                                              pict->linesize[0]) ^= 0x8080808080808080ULL;
-                        }
-                    }
+                    mbcount += add_mv(c, mvs, mvs_ext, mbcount, mb_type, mb_xy, 2 * i,
+                                      sx, sy, mx, my, direction);
+                }
+            } else if (IS_8X16(mb_type)) {
+                for (i = 0; i < 2; i++) {
+                    int sx = mb_x * 16 + 4 + 8 * i;
+                    int sy = mb_y * 16 + 8;
+                    int xy = (mb_x * 2 + i + mb_y * 2 * mv_stride) << (mv_sample_log2 - 1);
+                    int mx = motion_val[direction][xy][0];
+                    int my = motion_val[direction][xy][1];
 
-                    if (IS_INTERLACED(mb_type) &&
-                        avctx->codec->id == AV_CODEC_ID_H264) {
-                        // hmm
-                    }
+                    if (IS_INTERLACED(mb_type))
+                        my *= 2;
+
+                    mbcount += add_mv(c, mvs, mvs_ext, mbcount, mb_type, mb_xy, i,
+                                      sx, sy, mx, my, direction);
                 }
-                if (mbskip_table)
-                    mbskip_table[mb_index] = 0;
+            } else {
+                int sx = mb_x * 16 + 8;
+                int sy = mb_y * 16 + 8;
+                int xy = (mb_x + mb_y * mv_stride) << mv_sample_log2;
+                int mx = motion_val[direction][xy][0];
+                int my = motion_val[direction][xy][1];
+                mbcount += add_mv(c, mvs, mvs_ext, mbcount, mb_type, mb_xy, 0,
+                                      sx, sy, mx, my, direction);
             }
         }
     }
-#endif
-}
-void set_motion_vector_all(MpegEncContext *s, Picture *p, AVFrame *pict, enum AVCodecID id)
-{
-    set_motion_vector_core(s->avctx, pict, s->mbskip_table, p->mb_type,
-                         p->qscale_table, p->motion_val, &s->low_delay,
-                         s->mb_width, s->mb_height, s->mb_stride, s->quarter_sample, id);
-}
-
-#if 0
-#define COLOR(theta, r) \
-                u = (int)(128 + r * cos(theta * M_PI / 180)); \
-                v = (int)(128 + r * sin(theta * M_PI / 180));
 
-static int set_mb_context(AVMotionVector *mb, uint32_t mb_type,
-                  int dst_x, int dst_y,
-                  int motion_x, int motion_y, int motion_scale,
-                  int direction)
-{
-    mb->w = IS_8X8(mb_type) || IS_8X16(mb_type) ? 8 : 16;
-    mb->h = IS_8X8(mb_type) || IS_16X8(mb_type) ? 8 : 16;
-    mb->motion_x = motion_x;
-    mb->motion_y = motion_y;
-    mb->motion_scale = motion_scale;
-    mb->dst_x = dst_x;
-    mb->dst_y = dst_y;
-    mb->src_x = dst_x + motion_x / motion_scale;
-    mb->src_y = dst_y + motion_y / motion_scale;
-    mb->source = direction ? 1 : -1;
-    mb->flags = 0; // XXX: does mb_type contain extra information that could be exported here?
-    return 1;
+    return mbcount;
 }
 
-static int set_mv_side_data(AVCodecContext *avctx, AVFrame *pict, uint8_t *mbskip_table,
-                         uint32_t *mbtype_table, int8_t *qscale_table, int16_t (*motion_val[2])[2],
-                         int *low_delay,
-                         int mb_width, int mb_height, int mb_stride, int quarter_sample)
+/**
+ * Fill one macroblock row of the compact planes, on the grid motion_val is
+ * stored at, i.e. 4x4 blocks for H.264 and 8x8 blocks otherwise. The planes
+ * are filled straight from motion_val without looking at the partition type,
+ * except for skipping the 8x8 blocks that do not use the list when the
+ * reference indices are known.
+ */
+static int export_mb_row_compact(const MVExportContext *c, int mb_y)
 {
-    const int shift = 1 + quarter_sample;
-    const int scale = 1 << shift;
-    const int mv_sample_log2 = avctx->codec_id == AV_CODEC_ID_H264 || avctx->codec_id == AV_CODEC_ID_SVQ3 ? 2 : 1;
-    const int mv_stride      = (mb_width << mv_sample_log2) +
-                                (avctx->codec->id == AV_CODEC_ID_H264 ? 0 : 1);
-    int mb_x, mb_y, mbcount = 0;
-
-    /* size is width * height * 2 * 4 where 2 is for directions and 4 is
-        * for the maximum number of MB (4 MB in case of IS_8x8) */
-    AVMotionVector *mvs = av_malloc_array(mb_width * mb_height, 2 * 4 * sizeof(AVMotionVector));
-    if (!mvs)
-        return 0;
-
-    for (mb_y = 0; mb_y < mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < mb_width; mb_x++) {
-            int i, direction, mb_type = mbtype_table[mb_x + mb_y * mb_stride];
-            for (direction = 0; direction < 2; direction++) {
-                if (!USES_LIST(mb_type, direction))
-                    continue;
-                if (IS_8X8(mb_type)) {
-                    for (i = 0; i < 4; i++) {
-                        int sx = mb_x * 16 + 4 + 8 * (i & 1);
-                        int sy = mb_y * 16 + 4 + 8 * (i >> 1);
-                        int xy = (mb_x * 2 + (i & 1) +
-                                    (mb_y * 2 + (i >> 1)) * mv_stride) << (mv_sample_log2 - 1);
-                        int mx = motion_val[direction][xy][0];
-                        int my = motion_val[direction][xy][1];
-                        mbcount += set_mb_context(mvs + mbcount, mb_type, sx, sy, mx, my, scale, direction);
-                    }
-                } else if (IS_16X8(mb_type)) {
-                    for (i = 0; i < 2; i++) {
-                        int sx = mb_x * 16 + 8;
-                        int sy = mb_y * 16 + 4 + 8 * i;
-                        int xy = (mb_x * 2 + (mb_y * 2 + i) * mv_stride) << (mv_sample_log2 - 1);
-                        int mx = motion_val[direction][xy][0];
-                        int my = motion_val[direction][xy][1];
-
-                        if (IS_INTERLACED(mb_type))
-                            my *= 2;
-
-                        mbcount += set_mb_context(mvs + mbcount, mb_type, sx, sy, mx, my, scale, direction);
-                    }
-                } else if (IS_8X16(mb_type)) {
-                    for (i = 0; i < 2; i++) {
-                        int sx = mb_x * 16 + 4 + 8 * i;
-                        int sy = mb_y * 16 + 8;
-                        int xy = (mb_x * 2 + i + mb_y * 2 * mv_stride) << (mv_sample_log2 - 1);
-                        int mx = motion_val[direction][xy][0];
-                        int my = motion_val[direction][xy][1];
-
-                        if (IS_INTERLACED(mb_type))
-                            my *= 2;
-
-                        mbcount += set_mb_context(mvs + mbcount, mb_type, sx, sy, mx, my, scale, direction);
+    AVMotionVectorsCompact *mvc = c->mvc;
+    const int mb_blocks = 1 << c->mv_sample_log2;
+    int list, mb_x, x, y, count = 0;
+
+    for (list = 0; list < 2; list++) {
+        int16_t *mv_x = av_motion_vectors_compact_mv_x(mvc, list);
+        int16_t *mv_y = av_motion_vectors_compact_mv_y(mvc, list);
+        int8_t  *ref  = av_motion_vectors_compact_ref(mvc, list);
+        int16_t (*motion_val)[2] = c->motion_val[list];
+
+        if (!motion_val)
+            continue;
+
+        for (mb_x = 0; mb_x < c->mb_width; mb_x++) {
+            int mb_type = c->mbtype_table[mb_x + mb_y * c->mb_stride];
+            int yshift  = IS_INTERLACED(mb_type) &&
+                          (IS_16X8(mb_type) || IS_8X16(mb_type));
+
+            if (!USES_LIST(mb_type, list))
+                continue;
+
+            for (y = mb_y * mb_blocks; y < (mb_y + 1) * mb_blocks; y++) {
+                for (x = mb_x * mb_blocks; x < (mb_x + 1) * mb_blocks; x++) {
+                    int idx = x + y * mvc->nb_blocks_x;
+                    int xy  = x + y * c->mv_stride;
+                    int r   = 0;
+
+                    if (c->refs) {
+                        int blk = ((x & (mb_blocks - 1)) * 2 >> c->mv_sample_log2) +
+                                  ((y & (mb_blocks - 1)) * 2 >> c->mv_sample_log2) * 2;
+                        r = c->refs->ref_index[list][4 * (mb_x + mb_y * c->mb_stride) + blk];
+                        if (r < 0)
+                            continue;
                     }
-                } else {
-                        int sx = mb_x * 16 + 8;
-                        int sy = mb_y * 16 + 8;
-                        int xy = (mb_x + mb_y * mv_stride) << mv_sample_log2;
-                        int mx = motion_val[direction][xy][0];
-                        int my = motion_val[direction][xy][1];
-                        mbcount += set_mb_context(mvs + mbcount, mb_type, sx, sy, mx, my, scale, direction);
+
+                    mv_x[idx] = motion_val[xy][0];
+                    mv_y[idx] = motion_val[xy][1] * (1 << yshift);
+                    ref[idx]  = r;
+                    count++;
                 }
             }
         }
     }
 
-    if (mbcount) {
-        AVFrameSideData *pSideData;
-
-        av_log(avctx, AV_LOG_DEBUG, "Adding %d MVs info to frame %d\n", mbcount, avctx->frame_number);
-        // copy mvs to AVFrameSideData.
-        pSideData = av_frame_new_side_data(pict, AV_FRAME_DATA_MOTION_VECTORS, mbcount * sizeof(AVMotionVector));
-        if (!pSideData) {
-            av_freep(&mvs);
-            return 0;
-        }
-        memcpy(pSideData->data, mvs, mbcount * sizeof(AVMotionVector));
-    }
-    av_freep(&mvs);
-
-    return mbcount;
+    return count;
 }
 
-void set_motion_vector_hevc(AVCodecContext *avctx, AVFrame *pict, t_mb_info_for_mv *mb_info_mv)
+static int export_mvs_rows(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
 {
-    if (avctx == NULL || pict == NULL || mb_info_mv == NULL)
-    {
-        return;
-    }
+    MVExportContext *c = arg;
+    int mb_y_start = c->mb_height *  jobnr      / c->nb_jobs;
+    int mb_y_end   = c->mb_height * (jobnr + 1) / c->nb_jobs;
+    int mb_y;
 
-    uint8_t *mbskip_table = mb_info_mv->mbskip_table;
-    uint32_t *mbtype_table = mb_info_mv->mbtype;
-    int8_t *qscale_table = mb_info_mv->qscale_table;
-    int16_t (*motion_val[2])[2];//
-    motion_val[0] = mb_info_mv->motion_val[0];
-    motion_val[1] = mb_info_mv->motion_val[1];
-    int *low_delay = &mb_info_mv->low_delay;
-    int mb_width = mb_info_mv->mb_width;
-    int mb_height = mb_info_mv->mb_height;
-    int mb_stride = mb_info_mv->mb_stride;
-    int quarter_sample = mb_info_mv->quarter_sample;
-
-    if (!(avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS)){
-        av_log(NULL, AV_LOG_ERROR, "set_motion_vector failed, please av_dict_set flag2 first.");
-        return;
-    }
-    if (mbtype_table == NULL || motion_val[0] == NULL)
-    {
-        av_log(NULL, AV_LOG_ERROR, "set_motion_vector failed, NULL pointer detected.");
-        return;
+    if (c->mvs || c->mvs_ext) {
+        int offset = mb_y_start * c->mb_width * MAX_MB_MVS;
+        AVMotionVector    *mvs     = c->mvs     ? c->mvs     + offset : NULL;
+        AVMotionVectorExt *mvs_ext = c->mvs_ext ? c->mvs_ext + offset : NULL;
+        int count = 0;
+
+        for (mb_y = mb_y_start; mb_y < mb_y_end; mb_y++) {
+            int n = export_mb_row(c, mvs, mvs_ext, mb_y);
+            if (mvs)
+                mvs += n;
+            if (mvs_ext)
+                mvs_ext += n;
+            count += n;
+        }
+        c->count[jobnr] = count;
     }
 
-    int mbcount = 0;
-    mbcount = set_mv_side_data(avctx, pict, mbskip_table, mbtype_table, qscale_table, motion_val,low_delay,
-                         mb_width, mb_height, mb_stride, quarter_sample);
+    if (c->mvc) {
+        int count = 0;
 
-    if (mbcount <= 0)
-    {
-        return;
+        for (mb_y = mb_y_start; mb_y < mb_y_end; mb_y++)
+            count += export_mb_row_compact(c, mb_y);
+        c->count_compact[jobnr] = count;
     }
 
-    /* TODO: export all the following to make them accessible for users (and filters) */
-    if (avctx->hwaccel || !mbtype_table)
-        return;
-
-    int mb_y;
-    int i, ret;
-    int h_chroma_shift, v_chroma_shift, block_height;
-    const int mv_sample_log2 = avctx->codec_id == AV_CODEC_ID_H264 || avctx->codec_id == AV_CODEC_ID_SVQ3 ? 2 : 1;
-    const int mv_stride      = (mb_width << mv_sample_log2) + (avctx->codec->id == AV_CODEC_ID_H264 ? 0 : 1);
-
-    if (low_delay)
-        *low_delay = 0; // needed to see the vectors without trashing the buffers
-
-    ret = av_pix_fmt_get_chroma_sub_sample (avctx->pix_fmt, &h_chroma_shift, &v_chroma_shift);
-    if (ret)
-        return;
-
-    av_frame_make_writable(pict);
-
-    pict->opaque = NULL;
-    block_height = 16 >> v_chroma_shift;
-
-    for (mb_y = 0; mb_y < mb_height; mb_y++) {
-        int mb_x;
-        for (mb_x = 0; mb_x < mb_width; mb_x++) {
-            const int mb_index = mb_x + mb_y * mb_stride;
-            if (motion_val[0]) {
-                int mb_type = mbtype_table[mb_index];
-                uint64_t u,v;
-                int y;
-
-                u = v = 128;
-                if (IS_PCM(mb_type)) {
-                    COLOR(120, 48)
-                } else if ((IS_INTRA(mb_type) && IS_ACPRED(mb_type)) ||
-                            IS_INTRA16x16(mb_type)) {
-                    COLOR(30, 48)
-                } else if (IS_INTRA4x4(mb_type)) {
-                    COLOR(90, 48)
-                } else if (IS_DIRECT(mb_type) && IS_SKIP(mb_type)) {
-                    // COLOR(120, 48)
-                } else if (IS_DIRECT(mb_type)) {
-                    COLOR(150, 48)
-                } else if (IS_GMC(mb_type) && IS_SKIP(mb_type)) {
-                    COLOR(170, 48)
-                } else if (IS_GMC(mb_type)) {
-                    COLOR(190, 48)
-                } else if (IS_SKIP(mb_type)) {
-                    // COLOR(180, 48)
-                } else if (!USES_LIST(mb_type, 1)) {
-                    COLOR(240, 48)
-                } else if (!USES_LIST(mb_type, 0)) {
-                    COLOR(0, 48)
-                } else {
-                    av_assert2(USES_LIST(mb_type, 0) && USES_LIST(mb_type, 1));
-                    COLOR(300,48)
-                }
-
-                u *= 0x0101010101010101ULL;
-                v *= 0x0101010101010101ULL;
-                for (y = 0; y < block_height; y++) {
-                    *(uint64_t *)(pict->data[1] + 8 * mb_x +
-                                    (block_height * mb_y + y) * pict->linesize[1]) = u;
-                    *(uint64_t *)(pict->data[2] + 8 * mb_x +
-                                    (block_height * mb_y + y) * pict->linesize[2]) = v;
-                }
-
-                // segmentation
-                if (IS_8X8(mb_type) || IS_16X8(mb_type)) {
-                    *(uint64_t *)(pict->data[0] + 16 * mb_x + 0 +
-                                    (16 * mb_y + 8) * pict->linesize[0]) ^= 0x8080808080808080ULL;
-                    *(uint64_t *)(pict->data[0] + 16 * mb_x + 8 +
-                                    (16 * mb_y + 8) * pict->linesize[0]) ^= 0x8080808080808080ULL;
-                }
-                if (IS_8X8(mb_type) || IS_8X16(mb_type)) {
-                    for (y = 0; y < 16; y++)
-                        pict->data[0][16 * mb_x + 8 + (16 * mb_y + y) *
-                                        pict->linesize[0]] ^= 0x80;
-                }
-                if (IS_8X8(mb_type) && mv_sample_log2 >= 2) {
-                    int dm = 1 << (mv_sample_log2 - 2);
-                    for (i = 0; i < 4; i++) {
-                        int sx = mb_x * 16 + 8 * (i & 1);
-                        int sy = mb_y * 16 + 8 * (i >> 1);
-                        int xy = (mb_x * 2 + (i & 1) +
-                                    (mb_y * 2 + (i >> 1)) * mv_stride) << (mv_sample_log2 - 1);
-                        // FIXME bidir
-                        int32_t *mv = (int32_t *) &motion_val[0][xy];
-                        if (mv[0] != mv[dm] ||
-                            mv[dm * mv_stride] != mv[dm * (mv_stride + 1)])
-                            for (y = 0; y < 8; y++)
-                                pict->data[0][sx + 4 + (sy + y) * pict->linesize[0]] ^= 0x80;
-                        if (mv[0] != mv[dm * mv_stride] || mv[dm] != mv[dm * (mv_stride + 1)])
-                            *(uint64_t *)(pict->data[0] + sx + (sy + 4) *
-                                            pict->linesize[0]) ^= 0x8080808080808080ULL;
-                    }
-                }
+    return 0;
+}
 
-                if (IS_INTERLACED(mb_type) &&
-                    avctx->codec->id == AV_CODEC_ID_H264) {
-                    // hmm
-                }
-            }
-            if (mbskip_table)
-                mbskip_table[mb_index] = 0;
-        }
+/* make the per-job regions of the array contiguous and attach the used part
+ * of buf to the frame */
+static void attach_mvs(AVCodecContext *avctx, AVFrame *pict, const MVExportContext *c,
+                       AVBufferRef *buf, size_t elem_size, enum AVFrameSideDataType type)
+{
+    int i, mbcount = c->count[0];
+
+    for (i = 1; i < c->nb_jobs; i++) {
+        int mb_y_start = c->mb_height * i / c->nb_jobs;
+        memmove(buf->data + mbcount * elem_size,
+                buf->data + mb_y_start * c->mb_width * MAX_MB_MVS * elem_size,
+                c->count[i] * elem_size);
+        mbcount += c->count[i];
     }
 
+    if (mbcount)
+        av_log(avctx, AV_LOG_DEBUG, "Adding %d MVs info to frame %d\n", mbcount, avctx->frame_number);
+    ff_attach_mvs_buffer(avctx, pict, type, &buf, mbcount * elem_size);
 }
 
-void set_motion_vector(AVCodecContext *avctx, AVFrame *pict, t_mb_info_for_mv *mb_info_mv)
+void set_motion_vector_core(AVCodecContext *avctx, AVFrame *pict,
+                            uint32_t *mbtype_table, int16_t (*motion_val[2])[2],
+                            int mb_width, int mb_height, int mb_stride, int quarter_sample,
+                            const MVRefInfo *refs)
 {
-    if (avctx == NULL || pict == NULL || mb_info_mv == NULL)
-    {
-        return;
-    }
+    MVExportContext c = { 0 };
+    AVBufferRef *buf = NULL, *buf_ext = NULL;
 
-    uint8_t *mbskip_table = mb_info_mv->mbskip_table;
-    uint32_t *mbtype_table = mb_info_mv->mbtype;
-    int8_t *qscale_table = mb_info_mv->qscale_table;
-    int16_t (*motion_val[2])[2];//
-    motion_val[0] = mb_info_mv->motion_val[0];
-    motion_val[1] = mb_info_mv->motion_val[1];
-    int *low_delay = &mb_info_mv->low_delay;
-    int mb_width = mb_info_mv->mb_width;
-    int mb_height = mb_info_mv->mb_height;
-    int mb_stride = mb_info_mv->mb_stride;
-    int quarter_sample = mb_info_mv->quarter_sample;
-
-    if (!(avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS)){
-        av_log(NULL, AV_LOG_ERROR, "set_motion_vector failed, please av_dict_set flag2 first.");
-        return;
-    }
-    if (mbtype_table == NULL || motion_val[0] == NULL)
-    {
-        av_log(NULL, AV_LOG_ERROR, "set_motion_vector failed, NULL pointer detected.");
+    if (!mbtype_table)
         return;
+
+    c.mbtype_table   = mbtype_table;
+    c.motion_val     = motion_val;
+    c.mb_width       = mb_width;
+    c.mb_height      = mb_height;
+    c.mb_stride      = mb_stride;
+    c.mv_sample_log2 = avctx->codec_id == AV_CODEC_ID_H264 || avctx->codec_id == AV_CODEC_ID_SVQ3 ? 2 : 1;
+    c.mv_stride      = (mb_width << c.mv_sample_log2) +
+                       (avctx->codec->id == AV_CODEC_ID_H264 ? 0 : 1);
+    c.scale          = 1 << (1 + quarter_sample);
+    c.refs           = refs;
+
+    if ((avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS) && motion_val[0]) {
+        buf = ff_get_mvs_buffer(avctx, mb_width * mb_height * MAX_MB_MVS);
+        if (buf)
+            c.mvs = (AVMotionVector *)buf->data;
+        else
+            av_log(avctx, AV_LOG_ERROR, "Could not allocate motion vectors\n");
     }
 
-    int mbcount = 0;
-    mbcount = set_mv_side_data(avctx, pict, mbskip_table, mbtype_table, qscale_table, motion_val,low_delay,
-                         mb_width, mb_height, mb_stride, quarter_sample);
+    if ((avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_EXT) && motion_val[0]) {
+        buf_ext = ff_get_mvs_ext_buffer(avctx, mb_width * mb_height * MAX_MB_MVS);
+        if (buf_ext)
+            c.mvs_ext = (AVMotionVectorExt *)buf_ext->data;
+        else
+            av_log(avctx, AV_LOG_ERROR, "Could not allocate extended motion vectors\n");
+    }
 
-    if (mbcount <= 0)
-    {
-        return;
+    if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_COMPACT) {
+        c.mvc = av_motion_vectors_compact_create_side_data(pict, mb_width << c.mv_sample_log2,
+                                                           mb_height << c.mv_sample_log2, 2);
+        if (c.mvc) {
+            c.mvc->block_w      = 16 >> c.mv_sample_log2;
+            c.mvc->block_h      = 16 >> c.mv_sample_log2;
+            c.mvc->motion_scale = c.scale;
+        } else {
+            av_log(avctx, AV_LOG_ERROR, "Could not allocate compact motion vectors\n");
+        }
     }
 
-    /* TODO: export all the following to make them accessible for users (and filters) */
-    if (avctx->hwaccel || !mbtype_table)
+    if (!c.mvs && !c.mvs_ext && !c.mvc)
         return;
 
-    int mb_y;
-    int i, ret;
-    int h_chroma_shift, v_chroma_shift, block_height;
-    const int mv_sample_log2 = avctx->codec_id == AV_CODEC_ID_H264 || avctx->codec_id == AV_CODEC_ID_SVQ3 ? 2 : 1;
-    const int mv_stride      = (mb_width << mv_sample_log2) + (avctx->codec->id == AV_CODEC_ID_H264 ? 0 : 1);
-
-    if (low_delay)
-        *low_delay = 0; // needed to see the vectors without trashing the buffers
+    /* rows are independent, so split them over the slice threads if the
+     * decoder has them */
+    c.nb_jobs = av_clip(ff_thread_slice_count(avctx), 1, FFMIN(mb_height, MAX_JOBS));
+
+    if (c.nb_jobs > 1)
+        avctx->execute2(avctx, export_mvs_rows, &c, NULL, c.nb_jobs);
+    else
+        export_mvs_rows(avctx, &c, 0, 0);
+
+    if (buf)
+        attach_mvs(avctx, pict, &c, buf, sizeof(*c.mvs),
+                   AV_FRAME_DATA_MOTION_VECTORS);
+    if (buf_ext)
+        attach_mvs(avctx, pict, &c, buf_ext, sizeof(*c.mvs_ext),
+                   AV_FRAME_DATA_MOTION_VECTORS_EXT);
+    if (c.mvc) {
+        int i, count = 0;
+
+        for (i = 0; i < c.nb_jobs; i++)
+            count += c.count_compact[i];
+        /* like the other motion vector side data, omitted without vectors */
+        if (!count)
+            av_frame_remove_side_data(pict, AV_FRAME_DATA_MOTION_VECTORS_COMPACT);
+    }
+}
 
-    ret = av_pix_fmt_get_chroma_sub_sample (avctx->pix_fmt, &h_chroma_shift, &v_chroma_shift);
-    if (ret)
-        return;
+AVVideoEncParams *ff_export_block_params(AVFrame *pict, enum AVVideoEncParamsType type,
+                                         int qp, const uint32_t *mbtype_table,
+                                         const int8_t *qscale_table,
+                                         int mb_width, int mb_height, int mb_stride)
+{
+    AVVideoEncParams *par;
+    int mb_x, mb_y;
 
-    av_frame_make_writable(pict);
+    par = av_video_enc_params_create_side_data(pict, type, mb_width * mb_height);
+    if (!par)
+        return NULL;
 
-    pict->opaque = NULL;
-    block_height = 16 >> v_chroma_shift;
+    par->qp = qp;
 
     for (mb_y = 0; mb_y < mb_height; mb_y++) {
-        int mb_x;
         for (mb_x = 0; mb_x < mb_width; mb_x++) {
-            const int mb_index = mb_x + mb_y * mb_stride;
-            if (motion_val[0]) {
-                int mb_type = mbtype_table[mb_index];
-                uint64_t u,v;
-                int y;
-
-                u = v = 128;
-                if (IS_PCM(mb_type)) {
-                    COLOR(120, 48)
-                } else if ((IS_INTRA(mb_type) && IS_ACPRED(mb_type)) ||
-                            IS_INTRA16x16(mb_type)) {
-                    COLOR(30, 48)
-                } else if (IS_INTRA4x4(mb_type)) {
-                    COLOR(90, 48)
-                } else if (IS_DIRECT(mb_type) && IS_SKIP(mb_type)) {
-                    // COLOR(120, 48)
-                } else if (IS_DIRECT(mb_type)) {
-                    COLOR(150, 48)
-                } else if (IS_GMC(mb_type) && IS_SKIP(mb_type)) {
-                    COLOR(170, 48)
-                } else if (IS_GMC(mb_type)) {
-                    COLOR(190, 48)
-                } else if (IS_SKIP(mb_type)) {
-                    // COLOR(180, 48)
-                } else if (!USES_LIST(mb_type, 1)) {
-                    COLOR(240, 48)
-                } else if (!USES_LIST(mb_type, 0)) {
-                    COLOR(0, 48)
-                } else {
-                    av_assert2(USES_LIST(mb_type, 0) && USES_LIST(mb_type, 1));
-                    COLOR(300,48)
-                }
-
-                u *= 0x0101010101010101ULL;
-                v *= 0x0101010101010101ULL;
-                for (y = 0; y < block_height; y++) {
-                    *(uint64_t *)(pict->data[1] + 8 * mb_x +
-                                    (block_height * mb_y + y) * pict->linesize[1]) = u;
-                    *(uint64_t *)(pict->data[2] + 8 * mb_x +
-                                    (block_height * mb_y + y) * pict->linesize[2]) = v;
-                }
-
-                // segmentation
-                if (IS_8X8(mb_type) || IS_16X8(mb_type)) {
-                    *(uint64_t *)(pict->data[0] + 16 * mb_x + 0 +
-                                    (16 * mb_y + 8) * pict->linesize[0]) ^= 0x8080808080808080ULL;
-                    *(uint64_t *)(pict->data[0] + 16 * mb_x + 8 +
-                                    (16 * mb_y + 8) * pict->linesize[0]) ^= 0x8080808080808080ULL;
-                }
-                if (IS_8X8(mb_type) || IS_8X16(mb_type)) {
-                    for (y = 0; y < 16; y++)
-                        pict->data[0][16 * mb_x + 8 + (16 * mb_y + y) *
-                                        pict->linesize[0]] ^= 0x80;
-                }
-                if (IS_8X8(mb_type) && mv_sample_log2 >= 2) {
-                    int dm = 1 << (mv_sample_log2 - 2);
-                    for (i = 0; i < 4; i++) {
-                        int sx = mb_x * 16 + 8 * (i & 1);
-                        int sy = mb_y * 16 + 8 * (i >> 1);
-                        int xy = (mb_x * 2 + (i & 1) +
-                                    (mb_y * 2 + (i >> 1)) * mv_stride) << (mv_sample_log2 - 1);
-                        // FIXME bidir
-                        int32_t *mv = (int32_t *) &motion_val[0][xy];
-                        if (mv[0] != mv[dm] ||
-                            mv[dm * mv_stride] != mv[dm * (mv_stride + 1)])
-                            for (y = 0; y < 8; y++)
-                                pict->data[0][sx + 4 + (sy + y) * pict->linesize[0]] ^= 0x80;
-                        if (mv[0] != mv[dm * mv_stride] || mv[dm] != mv[dm * (mv_stride + 1)])
-                            *(uint64_t *)(pict->data[0] + sx + (sy + 4) *
-                                            pict->linesize[0]) ^= 0x8080808080808080ULL;
-                    }
-                }
-
-                if (IS_INTERLACED(mb_type) &&
-                    avctx->codec->id == AV_CODEC_ID_H264) {
-                    // hmm
-                }
+            AVVideoBlockParams *b = av_video_enc_params_block(par, mb_y * mb_width + mb_x);
+            int mb_xy       = mb_y * mb_stride + mb_x;
+            uint32_t mb_type = mbtype_table[mb_xy];
+
+            b->src_x    = mb_x * 16;
+            b->src_y    = mb_y * 16;
+            b->w        = 16;
+            b->h        = 16;
+            b->delta_qp = qscale_table[mb_xy] - qp;
+
+            if (IS_INTRA(mb_type)) {
+                b->type   = AV_VIDEO_BLOCK_TYPE_INTRA;
+                b->part_w = 16;
+                b->part_h = 16;
+            } else {
+                b->type   = IS_SKIP(mb_type) ? AV_VIDEO_BLOCK_TYPE_SKIP :
+                                               AV_VIDEO_BLOCK_TYPE_INTER;
+                b->part_w = IS_8X8(mb_type) || IS_8X16(mb_type) ? 8 : 16;
+                b->part_h = IS_8X8(mb_type) || IS_16X8(mb_type) ? 8 : 16;
             }
-            if (mbskip_table)
-                mbskip_table[mb_index] = 0;
         }
     }
 
+    return par;
 }
-#endif
 
+void set_motion_vector_all(MpegEncContext *s, Picture *p, AVFrame *pict)
+{
+    set_motion_vector_core(s->avctx, pict, p->mb_type, p->motion_val,
+                           s->mb_width, s->mb_height, s->mb_stride, s->quarter_sample,
+                           NULL);
+    if (s->avctx->export_side_data & AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS &&
+        !ff_export_block_params(pict, AV_VIDEO_ENC_PARAMS_MPEG, 0, p->mb_type,
+                                p->qscale_table, s->mb_width, s->mb_height, s->mb_stride))
+        av_log(s->avctx, AV_LOG_ERROR, "Could not allocate video encoding parameters\n");
+    ff_print_debug_mb_info(s->avctx, pict, s->mbskip_table, p->mb_type,
+                           p->qscale_table, p->motion_val, &s->low_delay,
+                           s->mb_width, s->mb_height, s->mb_stride);
+}
@@ -22,28 +22,87 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
-#include <libavutil/motion_vector.h>
-#include <libavformat/avformat.h>
+#ifndef AVCODEC_GET_MVS_H
+#define AVCODEC_GET_MVS_H
+
+#include "libavutil/frame.h"
+#include "libavutil/video_enc_params.h"
+
+#include "avcodec.h"
 #include "mpegpicture.h"
 
-typedef struct t_mb_info_for_mv{
-    int low_delay;
-    int mb_width;
-    int mb_height;
-    int mb_stride;
-    uint8_t *mbskip_table;
-    int quarter_sample;
-
-    //Picture
-    uint32_t *mbtype;          ///< types and macros are defined in mpegutils.h
-    int8_t *qscale_table;
-    int16_t (*motion_val[2])[2];
-}t_mb_info_for_mv;
-
-void set_motion_vector_all(struct MpegEncContext *s, Picture *p, AVFrame *pict, enum AVCodecID id);
-void set_motion_vector_core(AVCodecContext *avctx, AVFrame *pict, uint8_t *mbskip_table,
-                         uint32_t *mbtype_table, int8_t *qscale_table, int16_t (*motion_val[2])[2],
-                         int *low_delay,
-                         int mb_width, int mb_height, int mb_stride, int quarter_sample, enum AVCodecID id);
-void set_motion_vector(AVCodecContext *avctx, AVFrame *pict, t_mb_info_for_mv *mb_info_mv);
-void set_motion_vector_hevc(AVCodecContext *avctx, AVFrame *pict, t_mb_info_for_mv *mb_info_mv);
+struct MpegEncContext;
+
+/**
+ * Get a buffer able to hold max_count motion vectors from the per-context
+ * pool. The vectors are written in place and the buffer is attached to the
+ * frame as is, so no per-frame allocation or copy is needed.
+ */
+AVBufferRef *ff_get_mvs_buffer(AVCodecContext *avctx, int max_count);
+
+/**
+ * Same as ff_get_mvs_buffer() for AVMotionVectorExt.
+ */
+AVBufferRef *ff_get_mvs_ext_buffer(AVCodecContext *avctx, int max_count);
+
+/**
+ * Attach the first size bytes of a buffer from ff_get_mvs_buffer() or
+ * ff_get_mvs_ext_buffer() to the frame as side data of the given type.
+ * Nothing is attached if size is 0. Takes ownership of *buf in all cases.
+ */
+int ff_attach_mvs_buffer(AVCodecContext *avctx, AVFrame *frame,
+                         enum AVFrameSideDataType type, AVBufferRef **buf, int size);
+
+/**
+ * Reference identity of a picture with several references per list, used
+ * for AV_CODEC_EXPORT_DATA_MVS_EXT.
+ */
+typedef struct MVRefInfo {
+    /**
+     * Reference index of each 8x8 block and list, 4 entries per macroblock
+     * starting at 4 * mb_xy; negative when the block does not use the list.
+     */
+    int8_t *ref_index[2];
+    /**
+     * Number of references in each list and their POC minus the POC of
+     * the picture.
+     */
+    int nb_refs[2];
+    int poc_delta[2][32];
+} MVRefInfo;
+
+/**
+ * Export the motion vectors of a macroblock based picture as frame side
+ * data, as requested through avctx->export_side_data. This only extracts
+ * the vectors; the debug output and visualisation selected through
+ * avctx->debug are done separately by ff_print_debug_mb_info().
+ *
+ * @param refs the references of the picture, or NULL if each list has a
+ *             single reference of unknown POC
+ */
+void set_motion_vector_core(AVCodecContext *avctx, AVFrame *pict,
+                            uint32_t *mbtype_table, int16_t (*motion_val[2])[2],
+                            int mb_width, int mb_height, int mb_stride, int quarter_sample,
+                            const MVRefInfo *refs);
+
+/**
+ * Export the coding type, partitioning and quantiser of each macroblock as
+ * AV_FRAME_DATA_VIDEO_ENC_PARAMS side data, with delta_qp set to the entry
+ * of qscale_table minus qp. Intra macroblocks are exported with a single
+ * 16x16 partition.
+ *
+ * @return the side data, for the caller to fill in the per-frame fields,
+ *         or NULL on allocation failure
+ */
+AVVideoEncParams *ff_export_block_params(AVFrame *pict, enum AVVideoEncParamsType type,
+                                         int qp, const uint32_t *mbtype_table,
+                                         const int8_t *qscale_table,
+                                         int mb_width, int mb_height, int mb_stride);
+
+/**
+ * Export the motion vectors of an mpegvideo picture, then print the
+ * requested debug information.
+ */
+void set_motion_vector_all(struct MpegEncContext *s, Picture *p, AVFrame *pict);
+
+#endif /* AVCODEC_GET_MVS_H */
@@ -661,7 +661,7 @@ retry:
 
     if ((ret = av_frame_ref(pict, s->current_picture_ptr->f)) < 0)
         return ret;
-    set_motion_vector_all(s, s->current_picture_ptr, pict, avctx->codec_id);
+    set_motion_vector_all(s, s->current_picture_ptr, pict);
 
     *got_frame = 1;
 
@@ -687,5 +687,6 @@ AVCodec ff_h261_decoder = {
     .close          = h261_decode_end,
     .decode         = h261_decode_frame,
     .capabilities   = AV_CODEC_CAP_DR1,
+    .caps_internal  = FF_CODEC_CAP_MVS_ONLY,
     .max_lowres     = 3,
 };
@@ -274,7 +274,7 @@ static int decode_slice(MpegEncContext *s)
                 const int xy = s->mb_x + s->mb_y * s->mb_stride;
                 if (ret == SLICE_END) {
                     ff_mpv_reconstruct_mb(s, s->block);
-                    if (s->loop_filter)
+                    if (s->loop_filter && !(s->avctx->flags2 & AV_CODEC_FLAG2_MVS_ONLY))
                         ff_h263_loop_filter(s);
 
                     ff_er_add_slice(&s->er, s->resync_mb_x, s->resync_mb_y,
@@ -307,7 +307,7 @@ static int decode_slice(MpegEncContext *s)
             }
 
             ff_mpv_reconstruct_mb(s, s->block);
-            if (s->loop_filter)
+            if (s->loop_filter && !(s->avctx->flags2 & AV_CODEC_FLAG2_MVS_ONLY))
                 ff_h263_loop_filter(s);
         }
 
@@ -435,6 +435,7 @@ int ff_h263_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         if (s->low_delay == 0 && s->next_picture_ptr) {
             if ((ret = av_frame_ref(pict, s->next_picture_ptr->f)) < 0)
                 return ret;
+            set_motion_vector_all(s, s->next_picture_ptr, pict);
             s->next_picture_ptr = NULL;
 
             *got_frame = 1;
@@ -693,12 +694,12 @@ frame_end:
     if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay) {
         if ((ret = av_frame_ref(pict, s->current_picture_ptr->f)) < 0)
             return ret;
-        set_motion_vector_all(s, s->current_picture_ptr, pict, avctx->codec_id);
+        set_motion_vector_all(s, s->current_picture_ptr, pict);
         ff_mpv_export_qp_table(s, pict, s->current_picture_ptr, FF_QSCALE_TYPE_MPEG1);
     } else if (s->last_picture_ptr) {
         if ((ret = av_frame_ref(pict, s->last_picture_ptr->f)) < 0)
             return ret;
-        set_motion_vector_all(s, s->last_picture_ptr, pict, avctx->codec_id);
+        set_motion_vector_all(s, s->last_picture_ptr, pict);
         ff_mpv_export_qp_table(s, pict, s->last_picture_ptr, FF_QSCALE_TYPE_MPEG1);
     }
 
@@ -720,39 +721,6 @@ frame_end:
         }
         *got_frame = 1;
     }
-	
-#ifdef GET_MVS
-	// set mvs
-	if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay || s->last_picture_ptr)
-	{
-		t_mb_info_for_mv mb_info_mv;
-		mb_info_mv.low_delay = s->low_delay;
-		mb_info_mv.mb_width = s->mb_width;
-		mb_info_mv.mb_height = s->mb_height;
-		mb_info_mv.mb_stride = s->mb_stride;
-		mb_info_mv.mbskip_table = s->mbskip_table;
-		mb_info_mv.quarter_sample = s->quarter_sample;
-
-		if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay)
-		{
-			//Picture
-			mb_info_mv.mbtype = s->current_picture_ptr->mb_type;
-			mb_info_mv.qscale_table = s->current_picture_ptr->qscale_table;
-			mb_info_mv.motion_val[0] = s->current_picture_ptr->motion_val[0];
-			mb_info_mv.motion_val[1] = s->current_picture_ptr->motion_val[1];
-			av_frame_ref(pict, s->current_picture_ptr->f);
-			set_motion_vector(s->avctx, pict, &mb_info_mv);
-		} else {
-			//Picture
-			mb_info_mv.mbtype = s->last_picture_ptr->mb_type;
-			mb_info_mv.qscale_table = s->last_picture_ptr->qscale_table;
-			mb_info_mv.motion_val[0] = s->last_picture_ptr->motion_val[0];
-			mb_info_mv.motion_val[1] = s->last_picture_ptr->motion_val[1];
-			av_frame_ref(pict, s->last_picture_ptr->f);
-			set_motion_vector(s->avctx, pict, &mb_info_mv);
-		}
-	}
-#endif
 
     if (slice_ret < 0 && (avctx->err_recognition & AV_EF_EXPLODE))
         return slice_ret;
@@ -804,7 +772,8 @@ AVCodec ff_h263_decoder = {
     .decode         = ff_h263_decode_frame,
     .capabilities   = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                       AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY,
-    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_MVS_ONLY,
     .flush          = ff_mpeg_flush,
     .max_lowres     = 3,
     .pix_fmts       = ff_h263_hwaccel_pixfmt_list_420,
@@ -822,7 +791,8 @@ AVCodec ff_h263p_decoder = {
     .decode         = ff_h263_decode_frame,
     .capabilities   = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                       AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY,
-    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_MVS_ONLY,
     .flush          = ff_mpeg_flush,
     .max_lowres     = 3,
     .pix_fmts       = ff_h263_hwaccel_pixfmt_list_420,
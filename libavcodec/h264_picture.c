@@ -59,6 +59,7 @@ void ff_h264_unref_picture(H264Context *h, H264Picture *pic)
         av_buffer_unref(&pic->motion_val_buf[i]);
         av_buffer_unref(&pic->ref_index_buf[i]);
     }
+    av_buffer_unref(&pic->mvs_refs_buf);
 
     memset((uint8_t*)pic + off, 0, sizeof(*pic) - off);
 }
@@ -98,6 +99,15 @@ int ff_h264_ref_picture(H264Context *h, H264Picture *dst, H264Picture *src)
         dst->ref_index[i]  = src->ref_index[i];
     }
 
+    if (src->mvs_refs_buf) {
+        dst->mvs_refs_buf = av_buffer_ref(src->mvs_refs_buf);
+        if (!dst->mvs_refs_buf) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        dst->mvs_refs = src->mvs_refs;
+    }
+
     if (src->hwaccel_picture_private) {
         dst->hwaccel_priv_buf = av_buffer_ref(src->hwaccel_priv_buf);
         if (!dst->hwaccel_priv_buf) {
@@ -171,13 +171,17 @@ static int init_table_pools(H264Context *h)
     h->motion_val_pool   = av_buffer_pool_init(2 * (b4_array_size + 4) *
                                                sizeof(int16_t), av_buffer_allocz);
     h->ref_index_pool    = av_buffer_pool_init(4 * mb_array_size, av_buffer_allocz);
+    if (h->avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_EXT)
+        h->mvs_refs_pool = av_buffer_pool_init(sizeof(H264MVSRefs), NULL);
 
     if (!h->qscale_table_pool || !h->mb_type_pool || !h->motion_val_pool ||
-        !h->ref_index_pool) {
+        !h->ref_index_pool ||
+        (h->avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_EXT && !h->mvs_refs_pool)) {
         av_buffer_pool_uninit(&h->qscale_table_pool);
         av_buffer_pool_uninit(&h->mb_type_pool);
         av_buffer_pool_uninit(&h->motion_val_pool);
         av_buffer_pool_uninit(&h->ref_index_pool);
+        av_buffer_pool_uninit(&h->mvs_refs_pool);
         return AVERROR(ENOMEM);
     }
 
@@ -243,6 +247,14 @@ static int alloc_picture(H264Context *h, H264Picture *pic)
         pic->ref_index[i]  = pic->ref_index_buf[i]->data;
     }
 
+    if (h->mvs_refs_pool) {
+        pic->mvs_refs_buf = av_buffer_pool_get(h->mvs_refs_pool);
+        if (!pic->mvs_refs_buf)
+            goto fail;
+        pic->mvs_refs = (H264MVSRefs*)pic->mvs_refs_buf->data;
+        pic->mvs_refs->count[0] = pic->mvs_refs->count[1] = 0;
+    }
+
     pic->pps_buf = av_buffer_ref(h->ps.pps_ref);
     if (!pic->pps_buf)
         goto fail;
@@ -1935,6 +1947,36 @@ static int h264_slice_header_parse(const H264Context *h, H264SliceContext *sl,
     return 0;
 }
 
+/* merge the POC distances to the references of the slice into those of the
+ * current picture, for exporting them with the motion vectors; a reference
+ * index whose distance differs between slices gets an unknown distance */
+static void set_mvs_ref_poc_delta(const H264Context *h, H264SliceContext *sl)
+{
+    H264MVSRefs *const refs = h->cur_pic_ptr->mvs_refs;
+    int cur_poc = h->picture_structure == PICT_FRAME ? h->cur_pic_ptr->poc :
+                  h->cur_pic_ptr->field_poc[h->picture_structure == PICT_BOTTOM_FIELD];
+    int list, j;
+
+    if (!refs)
+        return;
+
+    for (list = 0; list < 2; list++) {
+        int count = list < sl->list_count ? sl->ref_count[list] : 0;
+
+        for (j = 0; j < count; j++) {
+            /* field macroblocks of MBAFF frames index the field references */
+            int delta = FRAME_MBAFF(h) ? INT32_MIN :
+                        sl->ref_list[list][j].poc - cur_poc;
+
+            if (j >= refs->count[list])
+                refs->poc_delta[list][j] = delta;
+            else if (refs->poc_delta[list][j] != delta)
+                refs->poc_delta[list][j] = INT32_MIN;
+        }
+        refs->count[list] = FFMAX(refs->count[list], count);
+    }
+}
+
 /* do all the per-slice initialization needed before we can start decoding the
  * actual MBs */
 static int h264_slice_init(H264Context *h, H264SliceContext *sl,
@@ -1977,8 +2019,10 @@ static int h264_slice_init(H264Context *h, H264SliceContext *sl,
         ff_h264_direct_dist_scale_factor(h, sl);
     if (!h->setup_finished)
         ff_h264_direct_ref_list_init(h, sl);
+    set_mvs_ref_poc_delta(h, sl);
 
     if (h->avctx->skip_loop_filter >= AVDISCARD_ALL ||
+        h->avctx->flags2 & AV_CODEC_FLAG2_MVS_ONLY ||
         (h->avctx->skip_loop_filter >= AVDISCARD_NONKEY &&
          h->nal_unit_type != H264_NAL_IDR_SLICE) ||
         (h->avctx->skip_loop_filter >= AVDISCARD_NONINTRA &&
@@ -2549,7 +2593,11 @@ static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
 
     ff_h264_draw_horiz_band(h, sl, top, height);
 
-    if (h->droppable || sl->h264->slice_ctx[0].er.error_occurred)
+    /* With several slices in flight, rows may complete out of order and
+     * filtering may be postponed; progress is then reported per batch in
+     * ff_h264_execute_decode_slices(). */
+    if (h->droppable || sl->h264->slice_ctx[0].er.error_occurred ||
+        h->nb_slice_ctx_queued > 1)
         return;
 
     ff_thread_report_progress(&h->cur_pic_ptr->tf, top + height - 1,
@@ -2858,6 +2906,18 @@ int ff_h264_execute_decode_slices(H264Context *h)
                 }
             }
         }
+
+        /* Everything above the row the last slice stopped in is final now,
+         * except for what deblocking the next slice may still touch. */
+        if (!h->droppable && !h->slice_ctx[0].er.error_occurred) {
+            int progress = h->mb_y >= h->mb_height ?
+                           16 * h->mb_height >> FIELD_PICTURE(h) :
+                           16 * (h->mb_y >> FIELD_PICTURE(h)) - ((16 + 4) << FRAME_MBAFF(h));
+
+            if (progress > 0)
+                ff_thread_report_progress(&h->cur_pic_ptr->tf, progress - 1,
+                                          h->picture_structure == PICT_BOTTOM_FIELD);
+        }
     }
 
 finish:
@@ -158,6 +158,7 @@ void ff_h264_free_tables(H264Context *h)
     av_buffer_pool_uninit(&h->mb_type_pool);
     av_buffer_pool_uninit(&h->motion_val_pool);
     av_buffer_pool_uninit(&h->ref_index_pool);
+    av_buffer_pool_uninit(&h->mvs_refs_pool);
 
     for (i = 0; i < h->nb_slice_ctx; i++) {
         H264SliceContext *sl = &h->slice_ctx[i];
@@ -326,7 +327,7 @@ static int h264_init_context(AVCodecContext *avctx, H264Context *h)
 
     ff_h264_sei_uninit(&h->sei);
 
-    h->nb_slice_ctx = (avctx->active_thread_type & FF_THREAD_SLICE) ? avctx->thread_count : 1;
+    h->nb_slice_ctx = ff_thread_slice_count(avctx);
     h->slice_ctx = av_mallocz_array(h->nb_slice_ctx, sizeof(*h->slice_ctx));
     if (!h->slice_ctx) {
         h->nb_slice_ctx = 0;
@@ -816,32 +817,28 @@ static int get_consumed_bytes(int pos, int buf_size)
 static int h264_export_enc_params(AVFrame *f, H264Picture *p)
 {
     AVVideoEncParams *par;
-    unsigned int nb_mb = p->mb_height * p->mb_width;
     unsigned int x, y;
 
-    par = av_video_enc_params_create_side_data(f, AV_VIDEO_ENC_PARAMS_H264, nb_mb);
+    par = ff_export_block_params(f, AV_VIDEO_ENC_PARAMS_H264, p->pps->init_qp,
+                                 p->mb_type, p->qscale_table,
+                                 p->mb_width, p->mb_height, p->mb_stride);
     if (!par)
         return AVERROR(ENOMEM);
 
-    par->qp = p->pps->init_qp;
-
     par->delta_qp[1][0] = p->pps->chroma_qp_index_offset[0];
     par->delta_qp[1][1] = p->pps->chroma_qp_index_offset[0];
     par->delta_qp[2][0] = p->pps->chroma_qp_index_offset[1];
     par->delta_qp[2][1] = p->pps->chroma_qp_index_offset[1];
 
+    /* intra 8x8 is signalled as intra 4x4 with the 8x8 transform */
     for (y = 0; y < p->mb_height; y++)
         for (x = 0; x < p->mb_width; x++) {
-            const unsigned int block_idx = y * p->mb_width + x;
             const unsigned int     mb_xy = y * p->mb_stride + x;
-            AVVideoBlockParams *b = av_video_enc_params_block(par, block_idx);
-
-            b->src_x = x * 16;
-            b->src_y = y * 16;
-            b->w     = 16;
-            b->h     = 16;
+            const uint32_t       mb_type = p->mb_type[mb_xy];
+            AVVideoBlockParams *b = av_video_enc_params_block(par, y * p->mb_width + x);
 
-            b->delta_qp = p->qscale_table[mb_xy] - par->qp;
+            if (IS_INTRA4x4(mb_type))
+                b->part_w = b->part_h = IS_8x8DCT(mb_type) ? 8 : 4;
         }
 
     return 0;
@@ -899,6 +896,7 @@ static int is_extra(const uint8_t *buf, int buf_size)
 
 static int finalize_frame(H264Context *h, AVFrame *dst, H264Picture *out, int *got_frame)
 {
+    MVRefInfo refs;
     int ret;
 
     if (((h->avctx->flags & AV_CODEC_FLAG_OUTPUT_CORRUPT) ||
@@ -931,42 +929,25 @@ static int finalize_frame(H264Context *h, AVFrame *dst, H264Picture *out, int *g
         ret = output_frame(h, dst, out);
         if (ret < 0)
             return ret;
-		
-		set_motion_vector_core(h->avctx, dst, NULL,
-						out->mb_type,
-						out->qscale_table,
-						out->motion_val,
-						NULL,
-						h->mb_width, h->mb_height, h->mb_stride, 1, AV_CODEC_ID_H264);
-#ifdef GET_MVS
-		// set mvs
-		{
-			t_mb_info_for_mv mb_info_mv;
-			mb_info_mv.low_delay = 0;
-			mb_info_mv.mb_width = h->mb_width;
-			mb_info_mv.mb_height = h->mb_height;
-			mb_info_mv.mb_stride = h->mb_stride;
-			mb_info_mv.mbskip_table = NULL;
-			mb_info_mv.quarter_sample = 1;
-
-			//Picture
-			mb_info_mv.mbtype = out->mb_type;
-			mb_info_mv.qscale_table = out->qscale_table;
-			mb_info_mv.motion_val[0] = out->motion_val[0];
-			mb_info_mv.motion_val[1] = out->motion_val[1];
-			set_motion_vector(h->avctx, dst, &mb_info_mv);
-		}
-#endif
+
+        memcpy(refs.ref_index, out->ref_index, sizeof(refs.ref_index));
+        memset(refs.nb_refs, 0, sizeof(refs.nb_refs));
+        if (out->mvs_refs) {
+            memcpy(refs.nb_refs,   out->mvs_refs->count,     sizeof(refs.nb_refs));
+            memcpy(refs.poc_delta, out->mvs_refs->poc_delta, sizeof(refs.poc_delta));
+        }
+        set_motion_vector_core(h->avctx, dst, out->mb_type, out->motion_val,
+                               h->mb_width, h->mb_height, h->mb_stride, 1, &refs);
 
         *got_frame = 1;
 
         if (CONFIG_MPEGVIDEO) {
-            ff_print_debug_info2(h->avctx, dst, NULL,
-                                 out->mb_type,
-                                 out->qscale_table,
-                                 out->motion_val,
-                                 NULL,
-                                 h->mb_width, h->mb_height, h->mb_stride, 1);
+            ff_print_debug_mb_info(h->avctx, dst, NULL,
+                                   out->mb_type,
+                                   out->qscale_table,
+                                   out->motion_val,
+                                   NULL,
+                                   h->mb_width, h->mb_height, h->mb_stride);
         }
     }
 
@@ -1132,7 +1113,9 @@ AVCodec ff_h264_decoder = {
                                NULL
                            },
     .caps_internal         = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_EXPORTS_CROPPING |
-                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP,
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP |
+                             FF_CODEC_CAP_FRAME_SLICE_THREADS |
+                             FF_CODEC_CAP_MVS_ONLY,
     .flush                 = h264_decode_flush,
     .update_thread_context = ONLY_IF_THREADS_ENABLED(ff_h264_update_thread_context),
     .profiles              = NULL_IF_CONFIG_SMALL(ff_h264_profiles),
@@ -125,6 +125,15 @@ typedef struct MMCO {
     int long_arg;       ///< index, pic_num, or num long refs depending on opcode
 } MMCO;
 
+/**
+ * POC distances to the references of a picture, for motion vector export,
+ * merged over all the slices of the picture.
+ */
+typedef struct H264MVSRefs {
+    int count[2];           ///< number of entries in poc_delta
+    int poc_delta[2][32];   ///< INT32_MIN where the slices of the picture disagree
+} H264MVSRefs;
+
 typedef struct H264Picture {
     AVFrame *f;
     ThreadFrame tf;
@@ -144,6 +153,9 @@ typedef struct H264Picture {
     AVBufferRef *ref_index_buf[2];
     int8_t *ref_index[2];
 
+    AVBufferRef *mvs_refs_buf;      ///< shared with the frame thread copies, as later slices update it
+    H264MVSRefs *mvs_refs;
+
     int field_poc[2];       ///< top/bottom POC
     int poc;                ///< frame POC
     int frame_num;          ///< frame_num (raw frame_num from slice header)
@@ -556,6 +568,7 @@ typedef struct H264Context {
     AVBufferPool *mb_type_pool;
     AVBufferPool *motion_val_pool;
     AVBufferPool *ref_index_pool;
+    AVBufferPool *mvs_refs_pool;
     int ref2frm[MAX_SLICES][2][64];     ///< reference to frame number lists, used in the loop filter, the first 2 are for -2,-1
 } H264Context;
 
@@ -21,6 +21,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/motion_vector.h"
+
 #include "hevc.h"
 #include "hevcdec.h"
 
@@ -772,3 +774,141 @@ scalef:
 
     mv->mv[LX] = mvpcand_list[mvp_lx_flag];
 }
+
+/* export the vectors as AVMotionVector, or as AVMotionVectorExt if ext is set */
+static int export_mvs(const HEVCFrame *ref, AVFrame *out, int ext)
+{
+    const int min_pu_size = 1 << ref->log2_min_pu_size;
+    AVFrameSideData *sd;
+    AVMotionVector *mvs = NULL;
+    AVMotionVectorExt *mvs_ext = NULL;
+    int x, y, list, nb_mvs = 0;
+
+    for (y = 0; y < ref->min_pu_height; y++) {
+        for (x = 0; x < ref->min_pu_width; x++) {
+            int idx = y * ref->min_pu_width + x;
+            if (ref->pu_info[idx].w && ref->tab_mvf[idx].pred_flag != PF_INTRA)
+                nb_mvs += (ref->tab_mvf[idx].pred_flag & PF_L0) +
+                          (ref->tab_mvf[idx].pred_flag >> 1);
+        }
+    }
+
+    if (!nb_mvs)
+        return 0;
+
+    if (ext) {
+        sd = av_frame_new_side_data(out, AV_FRAME_DATA_MOTION_VECTORS_EXT,
+                                    nb_mvs * sizeof(*mvs_ext));
+        if (!sd)
+            return AVERROR(ENOMEM);
+        mvs_ext = (AVMotionVectorExt *)sd->data;
+    } else {
+        sd = av_frame_new_side_data(out, AV_FRAME_DATA_MOTION_VECTORS,
+                                    nb_mvs * sizeof(*mvs));
+        if (!sd)
+            return AVERROR(ENOMEM);
+        mvs = (AVMotionVector *)sd->data;
+    }
+
+    for (y = 0; y < ref->min_pu_height; y++) {
+        for (x = 0; x < ref->min_pu_width; x++) {
+            int idx = y * ref->min_pu_width + x;
+            const PUInfo  *pu  = &ref->pu_info[idx];
+            const MvField *mvf = &ref->tab_mvf[idx];
+
+            if (!pu->w || mvf->pred_flag == PF_INTRA)
+                continue;
+
+            for (list = 0; list < 2; list++) {
+                AVMotionVector *mv;
+
+                if (!(mvf->pred_flag & (1 << list)))
+                    continue;
+                mv = mvs_ext ? &mvs_ext->mv : mvs++;
+                mv->source       = pu->poc_diff[list];
+                mv->w            = pu->w;
+                mv->h            = pu->h;
+                mv->dst_x        = x * min_pu_size + (pu->w >> 1);
+                mv->dst_y        = y * min_pu_size + (pu->h >> 1);
+                mv->motion_x     = mvf->mv[list].x;
+                mv->motion_y     = mvf->mv[list].y;
+                mv->motion_scale = 4;
+                mv->src_x        = mv->dst_x + mv->motion_x / 4;
+                mv->src_y        = mv->dst_y + mv->motion_y / 4;
+                mv->flags        = mvf->pred_flag == PF_BI ? AV_MOTION_VECTOR_FLAG_BIPRED : 0;
+
+                if (mvs_ext) {
+                    mvs_ext->self_size = sizeof(*mvs_ext);
+                    mvs_ext->ref_idx   = mvf->ref_idx[list];
+                    mvs_ext->poc_delta = pu->poc_diff[list];
+                    mvs_ext->list      = list;
+                    mvs_ext++;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* tab_mvf is stored per minimum PU, which is the grid exported here */
+static int export_mvs_compact(const HEVCFrame *ref, AVFrame *out)
+{
+    AVMotionVectorsCompact *mvc;
+    int x, y, list, nb_mvs = 0;
+
+    mvc = av_motion_vectors_compact_create_side_data(out, ref->min_pu_width,
+                                                     ref->min_pu_height, 2);
+    if (!mvc)
+        return AVERROR(ENOMEM);
+    mvc->block_w      = 1 << ref->log2_min_pu_size;
+    mvc->block_h      = 1 << ref->log2_min_pu_size;
+    mvc->motion_scale = 4;
+
+    for (list = 0; list < 2; list++) {
+        int16_t *mv_x = av_motion_vectors_compact_mv_x(mvc, list);
+        int16_t *mv_y = av_motion_vectors_compact_mv_y(mvc, list);
+        int8_t  *ref_idx = av_motion_vectors_compact_ref(mvc, list);
+
+        for (y = 0; y < ref->min_pu_height; y++) {
+            for (x = 0; x < ref->min_pu_width; x++) {
+                int idx = y * ref->min_pu_width + x;
+                const MvField *mvf = &ref->tab_mvf[idx];
+
+                if (!(mvf->pred_flag & (1 << list)))
+                    continue;
+                mv_x[idx]    = mvf->mv[list].x;
+                mv_y[idx]    = mvf->mv[list].y;
+                ref_idx[idx] = mvf->ref_idx[list];
+                nb_mvs++;
+            }
+        }
+    }
+
+    /* like the other motion vector side data, omitted without vectors */
+    if (!nb_mvs)
+        av_frame_remove_side_data(out, AV_FRAME_DATA_MOTION_VECTORS_COMPACT);
+
+    return 0;
+}
+
+int ff_hevc_export_mvs(HEVCContext *s, AVFrame *out)
+{
+    HEVCFrame *ref = &s->mvs_ref;
+    int ret = 0;
+
+    if (!ref->frame->buf[0])
+        return 0;
+
+    ff_thread_await_progress(&ref->tf, INT_MAX, 0);
+
+    if (s->avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS)
+        ret = export_mvs(ref, out, 0);
+    if (ret >= 0 && s->avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_EXT)
+        ret = export_mvs(ref, out, 1);
+    if (ret >= 0 && s->avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_COMPACT)
+        ret = export_mvs_compact(ref, out);
+
+    ff_hevc_unref_frame(s, ref, ~0);
+    return ret;
+}
@@ -51,6 +51,9 @@ void ff_hevc_unref_frame(HEVCContext *s, HEVCFrame *frame, int flags)
 
         av_buffer_unref(&frame->hwaccel_priv_buf);
         frame->hwaccel_picture_private = NULL;
+
+        av_buffer_unref(&frame->pu_info_buf);
+        frame->pu_info = NULL;
     }
 }
 
@@ -109,6 +112,16 @@ static HEVCFrame *alloc_frame(HEVCContext *s)
         for (j = 0; j < frame->ctb_count; j++)
             frame->rpl_tab[j] = (RefPicListTab *)frame->rpl_buf->data;
 
+        if (s->pu_info_pool && !s->avctx->hwaccel) {
+            frame->pu_info_buf = av_buffer_pool_get(s->pu_info_pool);
+            if (!frame->pu_info_buf)
+                goto fail;
+            frame->pu_info          = (PUInfo *)frame->pu_info_buf->data;
+            frame->min_pu_width     = s->ps.sps->min_pu_width;
+            frame->min_pu_height    = s->ps.sps->min_pu_height;
+            frame->log2_min_pu_size = s->ps.sps->log2_min_pu_size;
+        }
+
         frame->frame->top_field_first  = s->sei.picture_timing.picture_struct == AV_PICTURE_STRUCTURE_TOP_FIELD;
         frame->frame->interlaced_frame = (s->sei.picture_timing.picture_struct == AV_PICTURE_STRUCTURE_TOP_FIELD) || (s->sei.picture_timing.picture_struct == AV_PICTURE_STRUCTURE_BOTTOM_FIELD);
 
@@ -209,6 +222,8 @@ int ff_hevc_output_frame(HEVCContext *s, AVFrame *out, int flush)
             HEVCFrame *frame = &s->DPB[min_idx];
 
             ret = av_frame_ref(out, frame->frame);
+            if (ret >= 0 && frame->pu_info)
+                ret = ff_hevc_ref_mvs(s, frame);
             if (frame->flags & HEVC_FRAME_FLAG_BUMPING)
                 ff_hevc_unref_frame(s, frame, HEVC_FRAME_FLAG_OUTPUT | HEVC_FRAME_FLAG_BUMPING);
             else
@@ -230,6 +245,33 @@ int ff_hevc_output_frame(HEVCContext *s, AVFrame *out, int flush)
     return 0;
 }
 
+int ff_hevc_ref_mvs(HEVCContext *s, HEVCFrame *frame)
+{
+    HEVCFrame *dst = &s->mvs_ref;
+    int ret;
+
+    ff_hevc_unref_frame(s, dst, ~0);
+
+    ret = ff_thread_ref_frame(&dst->tf, &frame->tf);
+    if (ret < 0)
+        return ret;
+
+    dst->tab_mvf_buf = av_buffer_ref(frame->tab_mvf_buf);
+    dst->pu_info_buf = av_buffer_ref(frame->pu_info_buf);
+    if (!dst->tab_mvf_buf || !dst->pu_info_buf) {
+        ff_hevc_unref_frame(s, dst, ~0);
+        return AVERROR(ENOMEM);
+    }
+    dst->tab_mvf          = frame->tab_mvf;
+    dst->pu_info          = frame->pu_info;
+    dst->min_pu_width     = frame->min_pu_width;
+    dst->min_pu_height    = frame->min_pu_height;
+    dst->log2_min_pu_size = frame->log2_min_pu_size;
+    dst->poc              = frame->poc;
+
+    return 0;
+}
+
 void ff_hevc_bump_frame(HEVCContext *s)
 {
     int dpb = 0;
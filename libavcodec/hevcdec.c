@@ -81,6 +81,7 @@ static void pic_arrays_free(HEVCContext *s)
 
     av_buffer_pool_uninit(&s->tab_mvf_pool);
     av_buffer_pool_uninit(&s->rpl_tab_pool);
+    av_buffer_pool_uninit(&s->pu_info_pool);
 }
 
 /* allocate arrays that depend on frame dimensions */
@@ -133,6 +134,15 @@ static int pic_arrays_init(HEVCContext *s, const HEVCSPS *sps)
     if (!s->tab_mvf_pool || !s->rpl_tab_pool)
         goto fail;
 
+    if (s->avctx->export_side_data & (AV_CODEC_EXPORT_DATA_MVS |
+                                      AV_CODEC_EXPORT_DATA_MVS_COMPACT |
+                                      AV_CODEC_EXPORT_DATA_MVS_EXT)) {
+        s->pu_info_pool = av_buffer_pool_init(min_pu_size * sizeof(PUInfo),
+                                              av_buffer_allocz);
+        if (!s->pu_info_pool)
+            goto fail;
+    }
+
     return 0;
 
 fail:
@@ -1848,6 +1858,21 @@ static void hls_prediction_unit(HEVCContext *s, int x0, int y0,
         for (i = 0; i < nPbW >> s->ps.sps->log2_min_pu_size; i++)
             tab_mvf[(y_pu + j) * min_pu_width + x_pu + i] = current_mv;
 
+    if (s->ref->pu_info) {
+        PUInfo *pu_info = &s->ref->pu_info[y_pu * min_pu_width + x_pu];
+
+        for (j = 0; j < nPbH >> s->ps.sps->log2_min_pu_size; j++)
+            memset(pu_info + j * min_pu_width, 0,
+                   (nPbW >> s->ps.sps->log2_min_pu_size) * sizeof(*pu_info));
+
+        pu_info->w = nPbW;
+        pu_info->h = nPbH;
+        for (i = 0; i < 2; i++) {
+            if (current_mv.pred_flag & (1 << i))
+                pu_info->poc_diff[i] = av_clip_int16(refPicList[i].list[current_mv.ref_idx[i]] - s->poc);
+        }
+    }
+
     if (current_mv.pred_flag & PF_L0) {
         ref0 = refPicList[0].ref[current_mv.ref_idx[0]];
         if (!ref0)
@@ -3210,6 +3235,12 @@ static int hevc_decode_frame(AVCodecContext *avctx, void *data, int *got_output,
         if (ret < 0)
             return ret;
 
+        if (ret > 0) {
+            int err = ff_hevc_export_mvs(s, data);
+            if (err < 0)
+                return err;
+        }
+
         *got_output = ret;
         return 0;
     }
@@ -3253,6 +3284,9 @@ static int hevc_decode_frame(AVCodecContext *avctx, void *data, int *got_output,
     }
 
     if (s->output_frame->buf[0]) {
+        ret = ff_hevc_export_mvs(s, s->output_frame);
+        if (ret < 0)
+            return ret;
         av_frame_move_ref(data, s->output_frame);
         *got_output = 1;
     }
@@ -3321,6 +3355,8 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
         ff_hevc_unref_frame(s, &s->DPB[i], ~0);
         av_frame_free(&s->DPB[i].frame);
     }
+    ff_hevc_unref_frame(s, &s->mvs_ref, ~0);
+    av_frame_free(&s->mvs_ref.frame);
 
     ff_hevc_ps_uninit(&s->ps);
 
@@ -3374,6 +3410,11 @@ static av_cold int hevc_init_context(AVCodecContext *avctx)
         s->DPB[i].tf.f = s->DPB[i].frame;
     }
 
+    s->mvs_ref.frame = av_frame_alloc();
+    if (!s->mvs_ref.frame)
+        goto fail;
+    s->mvs_ref.tf.f = s->mvs_ref.frame;
+
     s->max_ra = INT_MAX;
 
     s->md5_ctx = av_md5_alloc();
@@ -3500,10 +3541,7 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
 
     atomic_init(&s->wpp_err, 0);
 
-    if(avctx->active_thread_type & FF_THREAD_SLICE)
-        s->threads_number = avctx->thread_count;
-    else
-        s->threads_number = 1;
+    s->threads_number = ff_thread_slice_count(avctx);
 
     if (!avctx->internal->is_copy) {
         if (avctx->extradata_size > 0 && avctx->extradata) {
@@ -3527,6 +3565,7 @@ static void hevc_decode_flush(AVCodecContext *avctx)
 {
     HEVCContext *s = avctx->priv_data;
     ff_hevc_flush_dpb(s);
+    ff_hevc_unref_frame(s, &s->mvs_ref, ~0);
     ff_hevc_reset_sei(&s->sei);
     s->max_ra = INT_MAX;
     s->eos = 1;
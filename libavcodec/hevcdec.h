@@ -347,6 +347,16 @@ typedef struct MvField {
     int8_t pred_flag;
 } MvField;
 
+/**
+ * Prediction unit geometry kept for motion vector export. Only the entry
+ * covering the top-left min PU of an inter prediction unit has a non-zero
+ * size, all the other entries of the unit are zeroed.
+ */
+typedef struct PUInfo {
+    uint8_t w, h;               ///< size of the prediction unit in luma samples
+    int16_t poc_diff[2];        ///< POC distance to the L0/L1 reference
+} PUInfo;
+
 typedef struct NeighbourAvailable {
     int cand_bottom_left;
     int cand_left;
@@ -409,6 +419,15 @@ typedef struct HEVCFrame {
     AVBufferRef *hwaccel_priv_buf;
     void *hwaccel_picture_private;
 
+    /**
+     * Prediction unit table, only allocated when motion vectors are exported
+     */
+    AVBufferRef *pu_info_buf;
+    PUInfo *pu_info;
+    int min_pu_width;
+    int min_pu_height;
+    int log2_min_pu_size;
+
     /**
      * A sequence counter, so that old frames are output first
      * after a POC reset
@@ -495,6 +514,12 @@ typedef struct HEVCContext {
 
     AVBufferPool *tab_mvf_pool;
     AVBufferPool *rpl_tab_pool;
+    AVBufferPool *pu_info_pool;
+
+    /**
+     * Frame whose motion vectors are exported along with output_frame.
+     */
+    HEVCFrame mvs_ref;
 
     ///< candidate references for the current frame
     RefPicList rps[5];
@@ -658,6 +683,19 @@ int ff_hevc_output_frame(HEVCContext *s, AVFrame *frame, int flush);
 
 void ff_hevc_bump_frame(HEVCContext *s);
 
+/**
+ * Keep a reference to the motion vector state of frame, to be exported by
+ * ff_hevc_export_mvs() once the frame is fully decoded.
+ */
+int ff_hevc_ref_mvs(HEVCContext *s, HEVCFrame *frame);
+
+/**
+ * Attach the motion vectors of s->mvs_ref to out as
+ * AV_FRAME_DATA_MOTION_VECTORS side data, one entry per prediction unit and
+ * reference list, and drop the reference.
+ */
+int ff_hevc_export_mvs(HEVCContext *s, AVFrame *out);
+
 void ff_hevc_unref_frame(HEVCContext *s, HEVCFrame *frame, int flags);
 
 void ff_hevc_set_neighbour_available(HEVCContext *s, int x0, int y0,
@@ -73,6 +73,17 @@
  * uses ff_thread_report/await_progress().
  */
 #define FF_CODEC_CAP_ALLOCATE_PROGRESS      (1 << 6)
+/**
+ * The decoder can run slice threads inside each of its frame threads
+ * when the user requests it with AVCodecContext.slice_thread_count.
+ */
+#define FF_CODEC_CAP_FRAME_SLICE_THREADS    (1 << 7)
+
+/**
+ * The decoder skips the pixel reconstruction when AV_CODEC_FLAG2_MVS_ONLY
+ * is set.
+ */
+#define FF_CODEC_CAP_MVS_ONLY               (1 << 8)
 
 /**
  * AVCodec.codec_tags termination value
@@ -132,7 +143,18 @@ typedef struct AVCodecInternal {
 
     AVBufferRef *pool;
 
+    /**
+     * Pools of worst-case sized AV_FRAME_DATA_MOTION_VECTORS and
+     * AV_FRAME_DATA_MOTION_VECTORS_EXT buffers, reinitialized when the
+     * required size changes.
+     */
+    AVBufferPool *mvs_pool;
+    int mvs_pool_size;
+    AVBufferPool *mvs_ext_pool;
+    int mvs_ext_pool_size;
+
     void *thread_ctx;
+    void *slice_thread_ctx;
 
     DecodeSimpleContext ds;
     AVBSFContext *bsf;
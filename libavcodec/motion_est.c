@@ -31,6 +31,8 @@
 #include <stdio.h>
 #include <limits.h>
 
+#include "libavutil/motion_vector.h"
+
 #include "avcodec.h"
 #include "internal.h"
 #include "mathops.h"
@@ -882,6 +884,61 @@ static inline int get_penalty_factor(int lambda, int lambda2, int type){
     }
 }
 
+void ff_me_load_mv_hints(MpegEncContext *s, const AVFrame *frame)
+{
+    MotionEstContext * const c = &s->me;
+    const AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+    const int shift = 1 + s->quarter_sample;
+    const AVMotionVector *mvs;
+    int i, nb_mvs, mb_x, mb_y;
+
+    if (!sd)
+        return;
+
+    memset(c->mv_hint_table, 0, s->mb_stride * s->mb_height * sizeof(*c->mv_hint_table));
+
+    mvs    = (const AVMotionVector *)sd->data;
+    nb_mvs = sd->size / sizeof(*mvs);
+    for (i = 0; i < nb_mvs; i++) {
+        const AVMotionVector *mv = &mvs[i];
+        int h = mv->flags & AV_MOTION_VECTOR_FLAG_FIELD ? 2 * mv->h : mv->h;
+        int x0 = mv->dst_x - mv->w / 2, x1 = x0 + mv->w;
+        int y0 = mv->dst_y - h / 2,     y1 = y0 + h;
+        int mx, my;
+
+        if (mv->source >= 0 || !mv->motion_scale)
+            continue;
+
+        mx = ROUNDED_DIV(mv->motion_x * (1 << shift), mv->motion_scale);
+        my = ROUNDED_DIV(mv->motion_y * (1 << shift), mv->motion_scale);
+
+        /* weight each vector by the area it covers in each macroblock */
+        for (mb_y = FFMAX(y0 >> 4, 0); mb_y <= FFMIN((y1 - 1) >> 4, s->mb_height - 1); mb_y++) {
+            int oh = FFMIN(y1, 16 * mb_y + 16) - FFMAX(y0, 16 * mb_y);
+            for (mb_x = FFMAX(x0 >> 4, 0); mb_x <= FFMIN((x1 - 1) >> 4, s->mb_width - 1); mb_x++) {
+                int *hint = c->mv_hint_table[mb_y * s->mb_stride + mb_x];
+                int area  = oh * (FFMIN(x1, 16 * mb_x + 16) - FFMAX(x0, 16 * mb_x));
+
+                hint[0] += mx * area;
+                hint[1] += my * area;
+                hint[2] += area;
+            }
+        }
+    }
+
+    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
+        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+            int *hint = c->mv_hint_table[mb_y * s->mb_stride + mb_x];
+            if (hint[2]) {
+                hint[0] = ROUNDED_DIV(hint[0], hint[2]);
+                hint[1] = ROUNDED_DIV(hint[1], hint[2]);
+            }
+        }
+    }
+
+    c->use_mv_hints = 1;
+}
+
 void ff_estimate_p_frame_motion(MpegEncContext * s,
                                 int mb_x, int mb_y)
 {
@@ -955,7 +1012,10 @@ void ff_estimate_p_frame_motion(MpegEncContext * s,
             c->pred_x = P_LEFT[0];
             c->pred_y = P_LEFT[1];
         }
+        if (c->use_mv_hints && c->mv_hint_table[s->mb_stride * mb_y + mb_x][2])
+            c->mv_hint = c->mv_hint_table[s->mb_stride * mb_y + mb_x];
         dmin = ff_epzs_motion_search(s, &mx, &my, P, 0, 0, s->p_mv_table, (1<<16)>>shift, 0, 16);
+        c->mv_hint = NULL;
     }
 
     /* At this point (mx,my) are full-pell and the relative displacement */
@@ -86,6 +86,12 @@ typedef struct MotionEstContext {
     int64_t mb_var_sum_temp;
     int scene_change_score;
 
+    int (*mv_hint_table)[3];        /**< per MB motion hints taken from the input
+                                     * frame: x and y in the MV unit of the
+                                     * encoder, and weight (0 if no hint) */
+    int use_mv_hints;               ///< set if mv_hint_table is valid for the current picture
+    const int *mv_hint;             ///< hint for the current search, NULL if none
+
     op_pixels_func(*hpel_put)[4];
     op_pixels_func(*hpel_avg)[4];
     qpel_mc_func(*qpel_put)[16];
@@ -110,6 +116,12 @@ static inline int ff_h263_round_chroma(int x)
 
 int ff_init_me(struct MpegEncContext *s);
 
+/**
+ * Load the motion hints of the current picture from the motion vectors
+ * attached to the input frame, if any, into mv_hint_table.
+ */
+void ff_me_load_mv_hints(struct MpegEncContext *s, const AVFrame *frame);
+
 void ff_estimate_p_frame_motion(struct MpegEncContext *s, int mb_x, int mb_y);
 void ff_estimate_b_frame_motion(struct MpegEncContext *s, int mb_x, int mb_y);
 
@@ -2067,7 +2067,7 @@ static int slice_end(AVCodecContext *avctx, AVFrame *pict)
             int ret = av_frame_ref(pict, s->current_picture_ptr->f);
             if (ret < 0)
                 return ret;
-            set_motion_vector_all(s, s->current_picture_ptr, pict, s->avctx->codec_id);
+            set_motion_vector_all(s, s->current_picture_ptr, pict);
             ff_mpv_export_qp_table(s, pict, s->current_picture_ptr, FF_QSCALE_TYPE_MPEG2);
         } else {
             if (avctx->active_thread_type & FF_THREAD_FRAME)
@@ -2078,44 +2078,11 @@ static int slice_end(AVCodecContext *avctx, AVFrame *pict)
                 int ret = av_frame_ref(pict, s->last_picture_ptr->f);
                 if (ret < 0)
                     return ret;
-                set_motion_vector_all(s, s->last_picture_ptr, pict, s->avctx->codec_id);
+                set_motion_vector_all(s, s->last_picture_ptr, pict);
                 ff_mpv_export_qp_table(s, pict, s->last_picture_ptr, FF_QSCALE_TYPE_MPEG2);
             }
         }
 
-#ifdef GET_MVS
-		// set mvs
-		if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay || s->last_picture_ptr)
-		{
-			t_mb_info_for_mv mb_info_mv;
-			mb_info_mv.low_delay = s->low_delay;
-			mb_info_mv.mb_width = s->mb_width;
-			mb_info_mv.mb_height = s->mb_height;
-			mb_info_mv.mb_stride = s->mb_stride;
-			mb_info_mv.mbskip_table = s->mbskip_table;
-			mb_info_mv.quarter_sample = s->quarter_sample;
-
-			if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay)
-			{
-				//Picture
-				mb_info_mv.mbtype = s->current_picture_ptr->mb_type;
-				mb_info_mv.qscale_table = s->current_picture_ptr->qscale_table;
-				mb_info_mv.motion_val[0] = s->current_picture_ptr->motion_val[0];
-				mb_info_mv.motion_val[1] = s->current_picture_ptr->motion_val[1];
-				av_frame_ref(pict, s->current_picture_ptr->f);
-				set_motion_vector(s->avctx, pict, &mb_info_mv);
-			} else {
-				//Picture
-				mb_info_mv.mbtype = s->last_picture_ptr->mb_type;
-				mb_info_mv.qscale_table = s->last_picture_ptr->qscale_table;
-				mb_info_mv.motion_val[0] = s->last_picture_ptr->motion_val[0];
-				mb_info_mv.motion_val[1] = s->last_picture_ptr->motion_val[1];
-				av_frame_ref(pict, s->last_picture_ptr->f);
-				set_motion_vector(s->avctx, pict, &mb_info_mv);
-			}
-		}
-#endif
-
         return 1;
     } else {
         return 0;
@@ -2835,6 +2802,7 @@ static int mpeg_decode_frame(AVCodecContext *avctx, void *data,
             int ret = av_frame_ref(picture, s2->next_picture_ptr->f);
             if (ret < 0)
                 return ret;
+            set_motion_vector_all(s2, s2->next_picture_ptr, picture);
 
             s2->next_picture_ptr = NULL;
 
@@ -2925,7 +2893,8 @@ AVCodec ff_mpeg1video_decoder = {
     .capabilities          = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                              AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY |
                              AV_CODEC_CAP_SLICE_THREADS,
-    .caps_internal         = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+    .caps_internal         = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                             FF_CODEC_CAP_MVS_ONLY,
     .flush                 = flush,
     .max_lowres            = 3,
     .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context),
@@ -2958,7 +2927,8 @@ AVCodec ff_mpeg2video_decoder = {
     .capabilities   = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                       AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY |
                       AV_CODEC_CAP_SLICE_THREADS,
-    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_MVS_ONLY,
     .flush          = flush,
     .max_lowres     = 3,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mpeg2_video_profiles),
@@ -3002,7 +2972,8 @@ AVCodec ff_mpegvideo_decoder = {
     .close          = mpeg_decode_end,
     .decode         = mpeg_decode_frame,
     .capabilities   = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 | AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS,
-    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_MVS_ONLY,
     .flush          = flush,
     .max_lowres     = 3,
 };
@@ -188,11 +188,19 @@ void ff_print_debug_info2(AVCodecContext *avctx, AVFrame *pict, uint8_t *mbskip_
         av_freep(&mvs);
     }
 
+    ff_print_debug_mb_info(avctx, pict, mbskip_table, mbtype_table, qscale_table,
+                           motion_val, low_delay, mb_width, mb_height, mb_stride);
+}
+
+void ff_print_debug_mb_info(AVCodecContext *avctx, AVFrame *pict, uint8_t *mbskip_table,
+                            uint32_t *mbtype_table, int8_t *qscale_table, int16_t (*motion_val[2])[2],
+                            int *low_delay,
+                            int mb_width, int mb_height, int mb_stride)
+{
     /* TODO: export all the following to make them accessible for users (and filters) */
     if (avctx->hwaccel || !mbtype_table)
         return;
 
-
     if (avctx->debug & (FF_DEBUG_SKIP | FF_DEBUG_QP | FF_DEBUG_MB_TYPE)) {
         int x,y;
 
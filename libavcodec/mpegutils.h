@@ -145,4 +145,14 @@ void ff_print_debug_info2(AVCodecContext *avctx, AVFrame *pict, uint8_t *mbskip_
                          int *low_delay,
                          int mb_width, int mb_height, int mb_stride, int quarter_sample);
 
+/**
+ * Print the per-macroblock debug information and draw the debug
+ * visualisation requested through avctx->debug and avctx->debug_mv.
+ * Unlike ff_print_debug_info2(), this does not export motion vectors.
+ */
+void ff_print_debug_mb_info(AVCodecContext *avctx, AVFrame *pict, uint8_t *mbskip_table,
+                            uint32_t *mbtype_table, int8_t *qscale_table, int16_t (*motion_val[2])[2],
+                            int *low_delay,
+                            int mb_width, int mb_height, int mb_stride);
+
 #endif /* AVCODEC_MPEGUTILS_H */
@@ -2013,6 +2013,9 @@ void mpv_reconstruct_mb_internal(MpegEncContext *s, int16_t block[12][64],
             } else{
                 *mbskip_ptr = 0; /* not skipped */
             }
+
+            if (s->avctx->flags2 & AV_CODEC_FLAG2_MVS_ONLY)
+                return;
         }
 
         dct_linesize = linesize << s->interlaced_dct;
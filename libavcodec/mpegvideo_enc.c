@@ -941,6 +941,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
                       MAX_PICTURE_COUNT * sizeof(Picture *), fail);
     FF_ALLOCZ_OR_GOTO(s->avctx, s->reordered_input_picture,
                       MAX_PICTURE_COUNT * sizeof(Picture *), fail);
+    if (s->mv_hints)
+        FF_ALLOCZ_OR_GOTO(s->avctx, s->me.mv_hint_table,
+                          s->mb_stride * s->mb_height * sizeof(*s->me.mv_hint_table), fail);
 
 
     if (s->noise_reduction) {
@@ -1098,6 +1101,7 @@ av_cold int ff_mpv_encode_end(AVCodecContext *avctx)
     av_freep(&s->input_picture);
     av_freep(&s->reordered_input_picture);
     av_freep(&s->dct_offset);
+    av_freep(&s->me.mv_hint_table);
 
     return 0;
 }
@@ -3700,6 +3704,10 @@ static int encode_picture(MpegEncContext *s, int picture_number)
         s->q_chroma_intra_matrix16 = s->q_intra_matrix16;
     }
 
+    s->me.use_mv_hints = 0;
+    if (s->me.mv_hint_table && s->pict_type == AV_PICTURE_TYPE_P)
+        ff_me_load_mv_hints(s, s->new_picture.f);
+
     s->mb_intra=0; //for the rate distortion & bit compare functions
     for(i=1; i<context_count; i++){
         ret = ff_update_duplicate_context(s->thread_context[i], s);
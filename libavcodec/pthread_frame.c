@@ -44,6 +44,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 enum {
     ///< Set when the thread is awaiting a packet.
@@ -109,6 +110,9 @@ typedef struct PerThreadContext {
     int async_serializing;
 
     atomic_int debug_threads;       ///< Set if the FF_DEBUG_THREADS option is set.
+
+    atomic_int progress_waiters;    ///< Number of threads waiting on progress_cond for frame progress.
+    atomic_int_least64_t stall_time; ///< Time spent by other threads waiting for this thread's frames with FF_DEBUG_THREADS, in microseconds.
 } PerThreadContext;
 
 /**
@@ -135,6 +139,8 @@ typedef struct FrameThreadContext {
                                     * Set for the first N packets, where N is the number of threads.
                                     * While it is set, ff_thread_en/decode_frame won't return any results.
                                     */
+
+    int64_t output_stall_time;     ///< Time spent by the user thread waiting for output with FF_DEBUG_THREADS, in microseconds.
 } FrameThreadContext;
 
 #define THREAD_SAFE_CALLBACKS(avctx) \
@@ -528,10 +534,18 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
         p = &fctx->threads[finished++];
 
         if (atomic_load(&p->state) != STATE_INPUT_READY) {
+            int64_t start = 0;
+
+            if (avctx->debug & FF_DEBUG_THREADS)
+                start = av_gettime_relative();
+
             pthread_mutex_lock(&p->progress_mutex);
             while (atomic_load_explicit(&p->state, memory_order_relaxed) != STATE_INPUT_READY)
                 pthread_cond_wait(&p->output_cond, &p->progress_mutex);
             pthread_mutex_unlock(&p->progress_mutex);
+
+            if (avctx->debug & FF_DEBUG_THREADS)
+                fctx->output_stall_time += av_gettime_relative() - start;
         }
 
         av_frame_move_ref(picture, p->frame);
@@ -568,30 +582,48 @@ finish:
 void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 {
     PerThreadContext *p;
-    atomic_int *progress = f->progress ? (atomic_int*)f->progress->data : NULL;
+    atomic_intptr_t *progress = f->progress ? (atomic_intptr_t*)f->progress->data : NULL;
+    intptr_t old;
 
-    if (!progress ||
-        atomic_load_explicit(&progress[field], memory_order_relaxed) >= n)
+    if (!progress)
         return;
 
+    /* With nested slice threads several threads report progress for the
+     * same frame, so only ever raise it. The progress
+     * values are intptr_t as the compat atomics only do compare-and-swap
+     * on those. */
+    old = atomic_load_explicit(&progress[field], memory_order_relaxed);
+    do {
+        if (old >= n)
+            return;
+    } while (!atomic_compare_exchange_weak(&progress[field], &old, n));
+
     p = f->owner[field]->internal->thread_ctx;
 
     if (atomic_load_explicit(&p->debug_threads, memory_order_relaxed))
         av_log(f->owner[field], AV_LOG_DEBUG,
                "%p finished %d field %d\n", progress, n, field);
 
-    pthread_mutex_lock(&p->progress_mutex);
-
-    atomic_store_explicit(&progress[field], n, memory_order_release);
-
-    pthread_cond_broadcast(&p->progress_cond);
-    pthread_mutex_unlock(&p->progress_mutex);
+    /*
+     * Only take the lock and wake up the waiting threads if there are any.
+     * The progress update and the load are sequentially consistent, as are
+     * the increment of progress_waiters and the progress check in
+     * ff_thread_await_progress(), so either the waiting thread sees the new
+     * progress or we see the waiting thread.
+     */
+    if (atomic_load(&p->progress_waiters)) {
+        pthread_mutex_lock(&p->progress_mutex);
+        pthread_cond_broadcast(&p->progress_cond);
+        pthread_mutex_unlock(&p->progress_mutex);
+    }
 }
 
 void ff_thread_await_progress(ThreadFrame *f, int n, int field)
 {
     PerThreadContext *p;
-    atomic_int *progress = f->progress ? (atomic_int*)f->progress->data : NULL;
+    int debug_threads;
+    int64_t start = 0;
+    atomic_intptr_t *progress = f->progress ? (atomic_intptr_t*)f->progress->data : NULL;
 
     if (!progress ||
         atomic_load_explicit(&progress[field], memory_order_acquire) >= n)
@@ -599,14 +631,23 @@ void ff_thread_await_progress(ThreadFrame *f, int n, int field)
 
     p = f->owner[field]->internal->thread_ctx;
 
-    if (atomic_load_explicit(&p->debug_threads, memory_order_relaxed))
+    debug_threads = atomic_load_explicit(&p->debug_threads, memory_order_relaxed);
+    if (debug_threads) {
         av_log(f->owner[field], AV_LOG_DEBUG,
                "thread awaiting %d field %d from %p\n", n, field, progress);
+        start = av_gettime_relative();
+    }
 
     pthread_mutex_lock(&p->progress_mutex);
-    while (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
+    atomic_fetch_add(&p->progress_waiters, 1);
+    while (atomic_load(&progress[field]) < n)
         pthread_cond_wait(&p->progress_cond, &p->progress_mutex);
+    atomic_fetch_sub(&p->progress_waiters, 1);
     pthread_mutex_unlock(&p->progress_mutex);
+
+    if (debug_threads)
+        atomic_fetch_add_explicit(&p->stall_time, av_gettime_relative() - start,
+                                  memory_order_relaxed);
 }
 
 void ff_thread_finish_setup(AVCodecContext *avctx) {
@@ -668,6 +709,14 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 
     park_frame_worker_threads(fctx, thread_count);
 
+    if (avctx->debug & FF_DEBUG_THREADS) {
+        for (i = 0; i < thread_count; i++)
+            av_log(avctx, AV_LOG_DEBUG, "thread %d: others stalled on its frames for %"PRId64" ms\n",
+                   i, (int64_t)atomic_load(&fctx->threads[i].stall_time) / 1000);
+        av_log(avctx, AV_LOG_DEBUG, "%d threads: output stalled for %"PRId64" ms\n",
+               thread_count, fctx->output_stall_time / 1000);
+    }
+
     if (fctx->prev_thread && avctx->internal->hwaccel_priv_data !=
                              fctx->prev_thread->avctx->internal->hwaccel_priv_data) {
         if (update_context_from_thread(avctx, fctx->prev_thread->avctx, 1) < 0) {
@@ -697,6 +746,9 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
         if (codec->close && p->avctx)
             codec->close(p->avctx);
 
+        if (p->avctx && p->avctx->internal && p->avctx->internal->slice_thread_ctx)
+            ff_slice_thread_free(p->avctx);
+
         release_delayed_buffers(p);
         av_frame_free(&p->frame);
     }
@@ -725,6 +777,8 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 
         if (p->avctx) {
             av_buffer_unref(&p->avctx->internal->pool);
+            av_buffer_pool_uninit(&p->avctx->internal->mvs_pool);
+            av_buffer_pool_uninit(&p->avctx->internal->mvs_ext_pool);
             av_freep(&p->avctx->internal);
             av_buffer_unref(&p->avctx->hw_frames_ctx);
         }
@@ -751,6 +805,7 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     const AVCodec *codec = avctx->codec;
     AVCodecContext *src = avctx;
     FrameThreadContext *fctx;
+    int slice_threads = 0;
     int i, err = 0;
 
     if (!thread_count) {
@@ -792,6 +847,11 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     if (codec->type == AVMEDIA_TYPE_VIDEO)
         avctx->delay = src->thread_count - 1;
 
+    if (avctx->slice_thread_count > 1 && avctx->thread_type & FF_THREAD_SLICE &&
+        codec->capabilities & AV_CODEC_CAP_SLICE_THREADS &&
+        codec->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS)
+        slice_threads = avctx->slice_thread_count;
+
     for (i = 0; i < thread_count; i++) {
         AVCodecContext *copy = av_malloc(sizeof(AVCodecContext));
         PerThreadContext *p  = &fctx->threads[i];
@@ -801,6 +861,8 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         pthread_cond_init(&p->input_cond, NULL);
         pthread_cond_init(&p->progress_cond, NULL);
         pthread_cond_init(&p->output_cond, NULL);
+        atomic_init(&p->progress_waiters, 0);
+        atomic_init(&p->stall_time, 0);
 
         p->frame = av_frame_alloc();
         if (!p->frame) {
@@ -849,6 +911,15 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         if (i)
             copy->internal->is_copy = 1;
 
+        if (slice_threads) {
+            err = ff_slice_thread_create(copy, slice_threads);
+            if (err < 0)
+                goto error;
+            if (err > 1)
+                copy->active_thread_type |= FF_THREAD_SLICE;
+            err = 0;
+        }
+
         if (codec->init)
             err = codec->init(copy);
 
@@ -930,12 +1001,12 @@ static int thread_get_buffer_internal(AVCodecContext *avctx, ThreadFrame *f, int
     }
 
     if (avctx->codec->caps_internal & FF_CODEC_CAP_ALLOCATE_PROGRESS) {
-        atomic_int *progress;
+        atomic_intptr_t *progress;
         f->progress = av_buffer_alloc(2 * sizeof(*progress));
         if (!f->progress) {
             return AVERROR(ENOMEM);
         }
-        progress = (atomic_int*)f->progress->data;
+        progress = (atomic_intptr_t*)f->progress->data;
 
         atomic_init(&progress[0], -1);
         atomic_init(&progress[1], -1);
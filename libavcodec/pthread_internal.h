@@ -26,6 +26,14 @@
 #define MAX_AUTO_THREADS 16
 
 int ff_slice_thread_init(AVCodecContext *avctx);
+/**
+ * Create a slice thread pool of thread_count threads for avctx and install
+ * the threaded execute callbacks. Does not touch avctx->thread_count.
+ *
+ * @return the number of threads in the pool, 1 if no pool was created
+ *         or a negative error code
+ */
+int ff_slice_thread_create(AVCodecContext *avctx, int thread_count);
 void ff_slice_thread_free(AVCodecContext *avctx);
 
 int ff_frame_thread_init(AVCodecContext *avctx);
@@ -675,7 +675,7 @@ static int rv10_decode_packet(AVCodecContext *avctx, const uint8_t *buf,
         if (s->pict_type != AV_PICTURE_TYPE_B)
             ff_h263_update_motion_val(s);
         ff_mpv_reconstruct_mb(s, s->block);
-        if (s->loop_filter)
+        if (s->loop_filter && !(avctx->flags2 & AV_CODEC_FLAG2_MVS_ONLY))
             ff_h263_loop_filter(s);
 
         if (++s->mb_x == s->mb_width) {
@@ -772,12 +772,12 @@ static int rv10_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay) {
             if ((ret = av_frame_ref(pict, s->current_picture_ptr->f)) < 0)
                 return ret;
-            set_motion_vector_all(s, s->current_picture_ptr, pict, avctx->codec_id);
+            set_motion_vector_all(s, s->current_picture_ptr, pict);
             ff_mpv_export_qp_table(s, pict, s->current_picture_ptr, FF_QSCALE_TYPE_MPEG1);
         } else if (s->last_picture_ptr) {
             if ((ret = av_frame_ref(pict, s->last_picture_ptr->f)) < 0)
                 return ret;
-            set_motion_vector_all(s, s->last_picture_ptr, pict, avctx->codec_id);
+            set_motion_vector_all(s, s->last_picture_ptr, pict);
             ff_mpv_export_qp_table(s, pict,s->last_picture_ptr, FF_QSCALE_TYPE_MPEG1);
         }
 
@@ -785,39 +785,6 @@ static int rv10_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
             *got_frame = 1;
         }
 
-#ifdef GET_MVS
-		// set mvs
-		if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay || s->last_picture_ptr)
-		{
-			t_mb_info_for_mv mb_info_mv;
-			mb_info_mv.low_delay = s->low_delay;
-			mb_info_mv.mb_width = s->mb_width;
-			mb_info_mv.mb_height = s->mb_height;
-			mb_info_mv.mb_stride = s->mb_stride;
-			mb_info_mv.mbskip_table = s->mbskip_table;
-			mb_info_mv.quarter_sample = s->quarter_sample;
-
-			if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay)
-			{
-				//Picture
-				mb_info_mv.mbtype = s->current_picture_ptr->mb_type;
-				mb_info_mv.qscale_table = s->current_picture_ptr->qscale_table;
-				mb_info_mv.motion_val[0] = s->current_picture_ptr->motion_val[0];
-				mb_info_mv.motion_val[1] = s->current_picture_ptr->motion_val[1];
-				av_frame_ref(pict, s->current_picture_ptr->f);
-				set_motion_vector(s->avctx, pict, &mb_info_mv);
-			} else {
-				//Picture
-				mb_info_mv.mbtype = s->last_picture_ptr->mb_type;
-				mb_info_mv.qscale_table = s->last_picture_ptr->qscale_table;
-				mb_info_mv.motion_val[0] = s->last_picture_ptr->motion_val[0];
-				mb_info_mv.motion_val[1] = s->last_picture_ptr->motion_val[1];
-				av_frame_ref(pict, s->last_picture_ptr->f);
-				set_motion_vector(s->avctx, pict, &mb_info_mv);
-			}
-		}
-#endif
-
         // so we can detect if frame_end was not called (find some nicer solution...)
         s->current_picture_ptr = NULL;
     }
@@ -835,6 +802,7 @@ AVCodec ff_rv10_decoder = {
     .close          = rv10_decode_end,
     .decode         = rv10_decode_frame,
     .capabilities   = AV_CODEC_CAP_DR1,
+    .caps_internal  = FF_CODEC_CAP_MVS_ONLY,
     .max_lowres     = 3,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_YUV420P,
@@ -852,6 +820,7 @@ AVCodec ff_rv20_decoder = {
     .close          = rv10_decode_end,
     .decode         = rv10_decode_frame,
     .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY,
+    .caps_internal  = FF_CODEC_CAP_MVS_ONLY,
     .flush          = ff_mpeg_flush,
     .max_lowres     = 3,
     .pix_fmts       = (const enum AVPixelFormat[]) {
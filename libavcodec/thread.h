@@ -34,8 +34,8 @@
 typedef struct ThreadFrame {
     AVFrame *f;
     AVCodecContext *owner[2];
-    // progress->data is an array of 2 ints holding progress for top/bottom
-    // fields
+    // progress->data is an array of 2 atomic_intptr_t holding progress for
+    // top/bottom fields
     AVBufferRef *progress;
 } ThreadFrame;
 
@@ -136,6 +136,14 @@ int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx,
         int (*action_func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr),
         int (*main_func)(AVCodecContext *c), void *arg, int *ret, int job_count);
 void ff_thread_free(AVCodecContext *s);
+
+/**
+ * Get the number of threads available to avctx->execute() and
+ * avctx->execute2(). This is avctx->thread_count for plain slice threading,
+ * the size of the per-frame-thread pool when slice threads are nested in
+ * frame threads, and 1 when slice threading is not active.
+ */
+int ff_thread_slice_count(AVCodecContext *avctx);
 int ff_alloc_entries(AVCodecContext *avctx, int count);
 void ff_reset_entries(AVCodecContext *avctx);
 void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n);
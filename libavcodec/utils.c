@@ -918,9 +918,14 @@ FF_ENABLE_DEPRECATION_WARNINGS
         && avctx->codec_descriptor->type == AVMEDIA_TYPE_VIDEO)
         av_log(avctx, AV_LOG_WARNING,
                "gray decoding requested but not enabled at configuration time\n");
-    if (avctx->flags2 & AV_CODEC_FLAG2_EXPORT_MVS) {
+    if (avctx->flags2 & (AV_CODEC_FLAG2_EXPORT_MVS | AV_CODEC_FLAG2_MVS_ONLY)) {
         avctx->export_side_data |= AV_CODEC_EXPORT_DATA_MVS;
     }
+    if (avctx->flags2 & AV_CODEC_FLAG2_MVS_ONLY && av_codec_is_decoder(avctx->codec) &&
+        !(avctx->codec->caps_internal & FF_CODEC_CAP_MVS_ONLY))
+        av_log(avctx, AV_LOG_WARNING,
+               "mvs_only requested but not supported by the %s decoder, "
+               "the pictures will be fully reconstructed\n", avctx->codec->name);
 
     if (   avctx->codec->init && (!(avctx->active_thread_type&FF_THREAD_FRAME)
         || avci->frame_thread_encoder)) {
@@ -1021,7 +1026,7 @@ free_and_end:
          (avctx->codec->caps_internal & FF_CODEC_CAP_INIT_CLEANUP)))
         avctx->codec->close(avctx);
 
-    if (HAVE_THREADS && avci->thread_ctx)
+    if (HAVE_THREADS && (avci->thread_ctx || avci->slice_thread_ctx))
         ff_thread_free(avctx);
 
     if (codec->priv_class && codec->priv_data_size)
@@ -1130,7 +1135,8 @@ av_cold int avcodec_close(AVCodecContext *avctx)
             avctx->internal->frame_thread_encoder && avctx->thread_count > 1) {
             ff_frame_thread_encoder_free(avctx);
         }
-        if (HAVE_THREADS && avctx->internal->thread_ctx)
+        if (HAVE_THREADS && (avctx->internal->thread_ctx ||
+                             avctx->internal->slice_thread_ctx))
             ff_thread_free(avctx);
         if (avctx->codec && avctx->codec->close)
             avctx->codec->close(avctx);
@@ -1145,6 +1151,8 @@ av_cold int avcodec_close(AVCodecContext *avctx)
         av_packet_free(&avctx->internal->ds.in_pkt);
 
         av_buffer_unref(&avctx->internal->pool);
+        av_buffer_pool_uninit(&avctx->internal->mvs_pool);
+        av_buffer_pool_uninit(&avctx->internal->mvs_ext_pool);
 
         if (avctx->hwaccel && avctx->hwaccel->uninit)
             avctx->hwaccel->uninit(avctx);
@@ -1895,6 +1903,11 @@ int ff_thread_can_start_frame(AVCodecContext *avctx)
     return 1;
 }
 
+int ff_thread_slice_count(AVCodecContext *avctx)
+{
+    return 1;
+}
+
 int ff_alloc_entries(AVCodecContext *avctx, int count)
 {
     return 0;
@@ -327,6 +327,22 @@ static inline void vc1_b_mc(VC1Context *v, int dmv_x[2], int dmv_y[2],
     ff_vc1_mc_1mv(v, (mode == BMV_TYPE_BACKWARD));
 }
 
+/** Macroblock type of a 1-MV B-frame MB, as stored in the picture
+ */
+static inline uint32_t vc1_b_mb_type(int direct, int mode)
+{
+    if (direct)
+        return MB_TYPE_DIRECT2 | MB_TYPE_16x16 | MB_TYPE_L0L1;
+    switch (mode) {
+    case BMV_TYPE_FORWARD:
+        return MB_TYPE_16x16 | MB_TYPE_L0;
+    case BMV_TYPE_BACKWARD:
+        return MB_TYPE_16x16 | MB_TYPE_L1;
+    default:
+        return MB_TYPE_16x16 | MB_TYPE_L0L1;
+    }
+}
+
 /** Get predicted DC value for I-frames only
  * prediction dir: left=0, top=1
  * @param s MpegEncContext
@@ -1333,7 +1349,7 @@ static int vc1_decode_p_mb(VC1Context *v)
                 s->current_picture.motion_val[1][s->block_index[0]][0] = 0;
                 s->current_picture.motion_val[1][s->block_index[0]][1] = 0;
             }
-            s->current_picture.mb_type[mb_pos] = s->mb_intra ? MB_TYPE_INTRA : MB_TYPE_16x16;
+            s->current_picture.mb_type[mb_pos] = s->mb_intra ? MB_TYPE_INTRA : MB_TYPE_16x16 | MB_TYPE_L0;
             ff_vc1_pred_mv(v, 0, dmv_x, dmv_y, 1, v->range_x, v->range_y, v->mb_type[0], 0, 0);
 
             /* FIXME Set DC val for inter block ? */
@@ -1399,7 +1415,7 @@ static int vc1_decode_p_mb(VC1Context *v)
                 v->mb_type[0][s->block_index[i]] = 0;
                 s->dc_val[0][s->block_index[i]]  = 0;
             }
-            s->current_picture.mb_type[mb_pos]      = MB_TYPE_SKIP;
+            s->current_picture.mb_type[mb_pos]      = MB_TYPE_SKIP | MB_TYPE_16x16 | MB_TYPE_L0;
             s->current_picture.qscale_table[mb_pos] = 0;
             ff_vc1_pred_mv(v, 0, 0, 0, 1, v->range_x, v->range_y, v->mb_type[0], 0, 0);
             ff_vc1_mc_1mv(v, 0);
@@ -1410,6 +1426,7 @@ static int vc1_decode_p_mb(VC1Context *v)
             int is_intra[6], is_coded[6];
             /* Get CBPCY */
             cbp = get_vlc2(&v->s.gb, v->cbpcy_vlc->table, VC1_CBPCY_P_VLC_BITS, 2);
+            s->current_picture.mb_type[mb_pos] = MB_TYPE_8x8 | MB_TYPE_L0;
             for (i = 0; i < 6; i++) {
                 val = ((cbp >> (5 - i)) & 1);
                 s->dc_val[0][s->block_index[i]] = 0;
@@ -1500,6 +1517,7 @@ static int vc1_decode_p_mb(VC1Context *v)
             }
         } else { // skipped MB
             s->mb_intra                               = 0;
+            s->current_picture.mb_type[mb_pos]      = MB_TYPE_SKIP | MB_TYPE_8x8 | MB_TYPE_L0;
             s->current_picture.qscale_table[mb_pos] = 0;
             for (i = 0; i < 6; i++) {
                 v->mb_type[0][s->block_index[i]] = 0;
@@ -1646,6 +1664,9 @@ static int vc1_decode_p_mb_intfr(VC1Context *v)
             for (i = 0; i < 6; i++)
                 v->mb_type[0][s->block_index[i]] = 0;
             fieldtx = v->fieldtx_plane[mb_pos] = ff_vc1_mbmode_intfrp[v->fourmvswitch][idx_mbmode][1];
+            s->current_picture.mb_type[mb_pos] = (fourmv ? MB_TYPE_8x8 : twomv ? MB_TYPE_16x8 : MB_TYPE_16x16) |
+                                                 (v->blk_mv_type[s->block_index[0]] ? MB_TYPE_INTERLACED : 0) |
+                                                 MB_TYPE_L0;
             /* for all motion vector read MVDATA and motion compensate each block */
             dst_idx = 0;
             if (fourmv) {
@@ -1717,7 +1738,7 @@ static int vc1_decode_p_mb_intfr(VC1Context *v)
             v->mb_type[0][s->block_index[i]] = 0;
             s->dc_val[0][s->block_index[i]] = 0;
         }
-        s->current_picture.mb_type[mb_pos]      = MB_TYPE_SKIP;
+        s->current_picture.mb_type[mb_pos]      = MB_TYPE_SKIP | MB_TYPE_16x16 | MB_TYPE_L0;
         s->current_picture.qscale_table[mb_pos] = 0;
         v->blk_mv_type[s->block_index[0]] = 0;
         v->blk_mv_type[s->block_index[1]] = 0;
@@ -1796,7 +1817,7 @@ static int vc1_decode_p_mb_intfi(VC1Context *v)
         }
     } else {
         s->mb_intra = v->is_intra[s->mb_x] = 0;
-        s->current_picture.mb_type[mb_pos + v->mb_off] = MB_TYPE_16x16;
+        s->current_picture.mb_type[mb_pos + v->mb_off] = MB_TYPE_16x16 | MB_TYPE_L0;
         for (i = 0; i < 6; i++)
             v->mb_type[0][s->block_index[i]] = 0;
         if (idx_mbmode <= 5) { // 1-MV
@@ -1808,6 +1829,7 @@ static int vc1_decode_p_mb_intfi(VC1Context *v)
             ff_vc1_mc_1mv(v, 0);
             mb_has_coeffs = !(idx_mbmode & 2);
         } else { // 4-MV
+            s->current_picture.mb_type[mb_pos + v->mb_off] = MB_TYPE_8x8 | MB_TYPE_L0;
             v->fourmvbp = get_vlc2(gb, v->fourmvbp_vlc->table, VC1_4MV_BLOCK_PATTERN_VLC_BITS, 1);
             for (i = 0; i < 4; i++) {
                 dmv_x = dmv_y = pred_flag = 0;
@@ -1921,6 +1943,8 @@ static int vc1_decode_b_mb(VC1Context *v)
     }
     for (i = 0; i < 6; i++)
         v->mb_type[0][s->block_index[i]] = s->mb_intra;
+    s->current_picture.mb_type[mb_pos] = s->mb_intra ? MB_TYPE_INTRA :
+                                         vc1_b_mb_type(direct, bmvtype) | (skipped ? MB_TYPE_SKIP : 0);
 
     if (skipped) {
         if (direct)
@@ -1955,6 +1979,8 @@ static int vc1_decode_b_mb(VC1Context *v)
         } else {
             if (bmvtype == BMV_TYPE_INTERPOLATED) {
                 GET_MVDATA(dmv_x[0], dmv_y[0]);
+                if (s->mb_intra)
+                    s->current_picture.mb_type[mb_pos] = MB_TYPE_INTRA;
                 if (!mb_has_coeffs) {
                     /* interpolated skipped block */
                     ff_vc1_pred_b_mv(v, dmv_x, dmv_y, direct, bmvtype);
@@ -2085,7 +2111,6 @@ static int vc1_decode_b_mb_intfi(VC1Context *v)
         }
     } else {
         s->mb_intra = v->is_intra[s->mb_x] = 0;
-        s->current_picture.mb_type[mb_pos + v->mb_off] = MB_TYPE_16x16;
         for (i = 0; i < 6; i++)
             v->mb_type[0][s->block_index[i]] = 0;
         if (v->fmb_is_raw)
@@ -2113,6 +2138,7 @@ static int vc1_decode_b_mb_intfi(VC1Context *v)
                 }
             }
             v->bmvtype = bmvtype;
+            s->current_picture.mb_type[mb_pos + v->mb_off] = vc1_b_mb_type(bmvtype == BMV_TYPE_DIRECT, bmvtype);
             if (bmvtype != BMV_TYPE_DIRECT && idx_mbmode & 1) {
                 get_mvdata_interlaced(v, &dmv_x[bmvtype == BMV_TYPE_BACKWARD], &dmv_y[bmvtype == BMV_TYPE_BACKWARD], &pred_flag[bmvtype == BMV_TYPE_BACKWARD]);
             }
@@ -2134,6 +2160,8 @@ static int vc1_decode_b_mb_intfi(VC1Context *v)
             if (fwd)
                 bmvtype = BMV_TYPE_FORWARD;
             v->bmvtype  = bmvtype;
+            s->current_picture.mb_type[mb_pos + v->mb_off] = MB_TYPE_8x8 |
+                (bmvtype == BMV_TYPE_BACKWARD ? MB_TYPE_L1 : MB_TYPE_L0);
             v->fourmvbp = get_vlc2(gb, v->fourmvbp_vlc->table, VC1_4MV_BLOCK_PATTERN_VLC_BITS, 1);
             for (i = 0; i < 4; i++) {
                 dmv_x[0] = dmv_y[0] = pred_flag[0] = 0;
@@ -2206,6 +2234,7 @@ static int vc1_decode_b_mb_intfr(VC1Context *v)
     int idx_mbmode = 0, mvbp;
     int stride_y, fieldtx;
     int bmvtype = BMV_TYPE_BACKWARD;
+    uint32_t mb_type;
     int dir, dir2;
 
     mquant = v->pq; /* Lossy initialization */
@@ -2336,6 +2365,19 @@ static int vc1_decode_b_mb_intfr(VC1Context *v)
                 mvsw = get_bits1(gb);
         }
 
+        /* the top and bottom field partitions of a 2-field MB may use
+         * different lists */
+        if (direct || bmvtype == BMV_TYPE_INTERPOLATED) {
+            mb_type = MB_TYPE_L0L1;
+        } else {
+            dir     = bmvtype == BMV_TYPE_BACKWARD;
+            mb_type = (MB_TYPE_P0L0 << 2 * dir) | (MB_TYPE_P1L0 << 2 * (dir ^ mvsw));
+        }
+        mb_type |= twomv   ? MB_TYPE_16x8 | MB_TYPE_INTERLACED : MB_TYPE_16x16;
+        mb_type |= direct  ? MB_TYPE_DIRECT2 : 0;
+        mb_type |= skipped ? MB_TYPE_SKIP : 0;
+        s->current_picture.mb_type[mb_pos] = mb_type;
+
         if (!skipped) { // inter MB
             mb_has_coeffs = ff_vc1_mbmode_intfrp[0][idx_mbmode][3];
             if (mb_has_coeffs)
@@ -2483,7 +2525,6 @@ static int vc1_decode_b_mb_intfr(VC1Context *v)
                 v->mb_type[0][s->block_index[i]] = 0;
                 s->dc_val[0][s->block_index[i]] = 0;
             }
-            s->current_picture.mb_type[mb_pos]      = MB_TYPE_SKIP;
             s->current_picture.qscale_table[mb_pos] = 0;
             v->blk_mv_type[s->block_index[0]] = 0;
             v->blk_mv_type[s->block_index[1]] = 0;
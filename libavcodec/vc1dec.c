@@ -39,6 +39,7 @@
 #include "vc1.h"
 #include "vc1data.h"
 #include "libavutil/avassert.h"
+#include "libavutil/motion_vector.h"
 #include "get_mvs.h"
 
 #if CONFIG_WMV3IMAGE_DECODER || CONFIG_VC1IMAGE_DECODER
@@ -628,6 +629,165 @@ av_cold int ff_vc1_decode_end(AVCodecContext *avctx)
 }
 
 
+static int vc1_add_mv(AVMotionVector *mv, int source, int w, int h,
+                      int dst_x, int dst_y, int motion_x, int motion_y,
+                      uint64_t flags)
+{
+    mv->source       = source;
+    mv->w            = w;
+    mv->h            = h;
+    mv->dst_x        = dst_x;
+    mv->dst_y        = dst_y;
+    mv->motion_x     = motion_x;
+    mv->motion_y     = motion_y;
+    mv->motion_scale = 4;
+    mv->src_x        = dst_x + motion_x / 4;
+    mv->src_y        = dst_y + motion_y / 4;
+    mv->flags        = flags;
+    return 1;
+}
+
+/**
+ * Export the motion vectors of the picture just decoded.
+ *
+ * This runs before the next picture overwrites the per-picture state. The
+ * lists and partitions used by each MB are taken from the stored MB type.
+ * Both fields of a field picture are exported, with their vertical position
+ * and vector converted to frame lines (the same and opposite field offsets
+ * cancel out in frame lines). Field vectors of interlaced frame pictures are
+ * already in frame lines. Vectors are always in quarter pel.
+ *
+ * The compact grid of a field picture has the interleaved field layout of
+ * AV_MOTION_VECTORS_COMPACT_FLAG_FIELDS.
+ *
+ * @param mv_f same/opposite field flags of the picture
+ */
+static void vc1_export_mvs(VC1Context *v, AVFrame *f, uint8_t *mv_f[2])
+{
+    MpegEncContext *s     = &v->s;
+    AVCodecContext *avctx = s->avctx;
+    AVBufferRef *buf      = NULL;
+    AVMotionVector *mvs   = NULL;
+    AVMotionVectorsCompact *mvc = NULL;
+    int mb_height = s->mb_height >> v->field_mode;
+    int field, list, mb_x, mb_y, n, count = 0, nb_compact = 0;
+
+    if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS) {
+        buf = ff_get_mvs_buffer(avctx, s->mb_width * s->mb_height * 8);
+        if (buf)
+            mvs = (AVMotionVector *)buf->data;
+        else
+            av_log(avctx, AV_LOG_ERROR, "Could not allocate motion vectors\n");
+    }
+
+    if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_COMPACT) {
+        mvc = av_motion_vectors_compact_create_side_data(f, 2 * s->mb_width, 2 * s->mb_height, 2);
+        if (mvc) {
+            mvc->block_w      = 8;
+            mvc->block_h      = 8;
+            mvc->motion_scale = 4;
+            mvc->flags        = v->field_mode ? AV_MOTION_VECTORS_COMPACT_FLAG_FIELDS : 0;
+        } else {
+            av_log(avctx, AV_LOG_ERROR, "Could not allocate compact motion vectors\n");
+        }
+    }
+
+    if (!mvs && !mvc)
+        return;
+
+    for (field = 0; field <= v->field_mode; field++) {
+        /* as cur_field_type, mb_off and blocks_off while decoding the field */
+        int parity     = v->field_mode && !(v->tff ^ field);
+        int mb_off     = field * mb_height * s->mb_stride;
+        int blocks_off = field * 2 * mb_height * s->b8_stride;
+        uint64_t field_flags = v->field_mode ? AV_MOTION_VECTOR_FLAG_FIELD : 0;
+
+        if (parity)
+            field_flags |= AV_MOTION_VECTOR_FLAG_BOTTOM_FIELD;
+
+        for (mb_y = 0; mb_y < mb_height; mb_y++) {
+            for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+                uint32_t mb_type = s->current_picture.mb_type[mb_x + mb_y * s->mb_stride + mb_off];
+                int mb_xy = 2 * mb_x + 2 * mb_y * s->b8_stride + blocks_off;
+
+                if (IS_INTRA(mb_type))
+                    continue;
+
+                for (list = 0; list < 2; list++) {
+                    for (n = 0; n < 4; n++) {
+                        int xy = mb_xy + (n & 1) + (n >> 1) * s->b8_stride;
+                        int part = IS_16X8(mb_type) ? n >> 1 : 0;
+                        int mx = s->current_picture.motion_val[list][xy][0];
+                        int my = s->current_picture.motion_val[list][xy][1] * (1 << v->field_mode);
+                        int w = 16, h = 16, dst_x, dst_y;
+                        uint64_t flags = field_flags;
+
+                        if (!IS_DIR(mb_type, part, list))
+                            continue;
+                        /* intra blocks of a progressive 4-MV MB */
+                        if (!v->field_mode && v->mb_type[0][xy])
+                            continue;
+
+                        if (mvc) {
+                            int x   = 2 * mb_x + (n & 1);
+                            int y   = v->field_mode ? 2 * (2 * mb_y + (n >> 1)) + parity
+                                                    : 2 * mb_y + (n >> 1);
+                            int idx = x + y * mvc->nb_blocks_x;
+
+                            av_motion_vectors_compact_mv_x(mvc, list)[idx] = mx;
+                            av_motion_vectors_compact_mv_y(mvc, list)[idx] = my;
+                            av_motion_vectors_compact_ref(mvc, list)[idx]  = v->field_mode ? mv_f[list][xy] : 0;
+                            nb_compact++;
+                        }
+
+                        if (!mvs)
+                            continue;
+
+                        dst_x = mb_x * 16 + 8;
+                        dst_y = mb_y * 16 + 8;
+                        if (IS_8X8(mb_type)) {
+                            w      = 8;
+                            dst_x += 8 * (n & 1) - 4;
+                        } else if (IS_16X8(mb_type)) {
+                            if (n & 1)
+                                continue;
+                        } else if (n) {
+                            continue;
+                        }
+                        if (IS_INTERLACED(mb_type)) {
+                            /* field vector of an interlaced frame MB */
+                            h      = 8;
+                            dst_y += n >> 1;
+                            flags |= AV_MOTION_VECTOR_FLAG_FIELD;
+                            if (n >> 1)
+                                flags |= AV_MOTION_VECTOR_FLAG_BOTTOM_FIELD;
+                        } else if (IS_8X8(mb_type)) {
+                            h      = 8;
+                            dst_y += 8 * (n >> 1) - 4;
+                        }
+                        if (v->field_mode)
+                            dst_y = 2 * dst_y + parity;
+                        if (IS_DIRECT(mb_type))
+                            flags |= AV_MOTION_VECTOR_FLAG_DIRECT;
+
+                        count += vc1_add_mv(mvs + count, list ? 1 : -1, w, h,
+                                            dst_x, dst_y, mx, my, flags);
+                    }
+                }
+            }
+        }
+    }
+
+    /* like the other motion vector side data, omitted without vectors */
+    if (mvc && !nb_compact)
+        av_frame_remove_side_data(f, AV_FRAME_DATA_MOTION_VECTORS_COMPACT);
+
+    if (!buf)
+        return;
+
+    ff_attach_mvs_buffer(avctx, f, AV_FRAME_DATA_MOTION_VECTORS, &buf, count * sizeof(*mvs));
+}
+
 /** Decode a VC1/WMV3 frame
  * @todo TODO: Handle VC-1 IDUs (Transport level?)
  */
@@ -1137,6 +1297,14 @@ static int vc1_decode_frame(AVCodecContext *avctx, void *data,
         }
         if (!v->field_mode)
             ff_er_frame_end(&s->er);
+
+        if ((avctx->export_side_data & (AV_CODEC_EXPORT_DATA_MVS | AV_CODEC_EXPORT_DATA_MVS_COMPACT)) &&
+            !v->x8_type && !v->p_frame_skipped) {
+            /* the flags of a P field picture were moved to mv_f_next above */
+            int swapped = v->field_mode && s->pict_type != AV_PICTURE_TYPE_B &&
+                          s->pict_type != AV_PICTURE_TYPE_BI;
+            vc1_export_mvs(v, s->current_picture_ptr->f, swapped ? v->mv_f_next : v->mv_f);
+        }
     }
 
     ff_mpv_frame_end(s);
@@ -1156,19 +1324,34 @@ image:
         *got_frame = 1;
     } else {
         if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay) {
-			if ((ret = av_frame_ref(pict, s->current_picture_ptr->f)) < 0) {
-					av_log(NULL, AV_LOG_ERROR, "av_frame_ref failed. ret=%d\n", ret);
-					goto err;
-				}
-			set_motion_vector_all(s, s->current_picture_ptr, pict, avctx->codec_id);
-
+            if ((ret = av_frame_ref(pict, s->current_picture_ptr->f)) < 0) {
+                av_log(NULL, AV_LOG_ERROR, "av_frame_ref failed. ret=%d\n", ret);
+                goto err;
+            }
+            if (!v->field_mode) {
+                ff_print_debug_mb_info(avctx, pict, s->mbskip_table, s->current_picture_ptr->mb_type,
+                                       s->current_picture_ptr->qscale_table, s->current_picture_ptr->motion_val,
+                                       &s->low_delay, s->mb_width, s->mb_height, s->mb_stride);
+                if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS &&
+                    !ff_export_block_params(pict, AV_VIDEO_ENC_PARAMS_MPEG, 0, s->current_picture_ptr->mb_type,
+                                            s->current_picture_ptr->qscale_table, s->mb_width, s->mb_height, s->mb_stride))
+                    av_log(avctx, AV_LOG_ERROR, "Could not allocate video encoding parameters\n");
+            }
             *got_frame = 1;
         } else if (s->last_picture_ptr) {
             if ((ret = av_frame_ref(pict, s->last_picture_ptr->f)) < 0) {
                 av_log(NULL, AV_LOG_ERROR, "av_frame_ref failed. ret=%d\n", ret);
                 goto err;
             }
-            set_motion_vector_all(s, s->last_picture_ptr, pict, avctx->codec_id);
+            if (!v->field_mode) {
+                ff_print_debug_mb_info(avctx, pict, s->mbskip_table, s->last_picture_ptr->mb_type,
+                                       s->last_picture_ptr->qscale_table, s->last_picture_ptr->motion_val,
+                                       &s->low_delay, s->mb_width, s->mb_height, s->mb_stride);
+                if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS &&
+                    !ff_export_block_params(pict, AV_VIDEO_ENC_PARAMS_MPEG, 0, s->last_picture_ptr->mb_type,
+                                            s->last_picture_ptr->qscale_table, s->mb_width, s->mb_height, s->mb_stride))
+                    av_log(avctx, AV_LOG_ERROR, "Could not allocate video encoding parameters\n");
+            }
             *got_frame = 1;
         }
     }
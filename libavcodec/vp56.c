@@ -23,6 +23,8 @@
  * VP5 and VP6 compatible video decoder (common features)
  */
 
+#include "libavutil/motion_vector.h"
+
 #include "avcodec.h"
 #include "bytestream.h"
 #include "internal.h"
@@ -197,6 +199,9 @@ static void vp56_decode_4mv(VP56Context *s, int row, int col)
     /* this is the one selected for the whole MB for prediction */
     s->macroblocks[row * s->mb_width + col].mv = s->mv[3];
 
+    if (s->block_mvs)
+        memcpy(s->block_mvs[row * s->mb_width + col], s->mv, sizeof(*s->block_mvs));
+
     /* chroma vectors are average luma vectors */
     s->mv[4].x = s->mv[5].x = RSHIFT(mv.x,2);
     s->mv[4].y = s->mv[5].y = RSHIFT(mv.y,2);
@@ -549,6 +554,13 @@ static int vp56_size_changed(VP56Context *s)
                       sizeof(*s->above_blocks));
     av_reallocp_array(&s->macroblocks, s->mb_width*s->mb_height,
                       sizeof(*s->macroblocks));
+    if (avctx->export_side_data & (AV_CODEC_EXPORT_DATA_MVS |
+                                   AV_CODEC_EXPORT_DATA_MVS_COMPACT)) {
+        av_reallocp_array(&s->block_mvs, s->mb_width*s->mb_height,
+                          sizeof(*s->block_mvs));
+        if (!s->block_mvs)
+            return AVERROR(ENOMEM);
+    }
     av_free(s->edge_emu_buffer_alloc);
     s->edge_emu_buffer_alloc = av_malloc(16*stride);
     s->edge_emu_buffer = s->edge_emu_buffer_alloc;
@@ -565,6 +577,120 @@ static int vp56_size_changed(VP56Context *s)
 
 static int ff_vp56_decode_mbs(AVCodecContext *avctx, void *, int, int);
 
+static int vp56_export_mvs(VP56Context *s, AVFrame *frame)
+{
+    const int scale = s->vp56_coord_div[0];
+    AVFrameSideData *sd;
+    AVMotionVector *mvs;
+    int mb_row, mb_col, b, nb_mvs = 0;
+
+    for (b = 0; b < s->mb_width * s->mb_height; b++) {
+        if (s->macroblocks[b].type == VP56_MB_INTER_4V)
+            nb_mvs += 4;
+        else if (s->macroblocks[b].type != VP56_MB_INTRA)
+            nb_mvs++;
+    }
+
+    if (!nb_mvs)
+        return 0;
+
+    sd = av_frame_new_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS,
+                                nb_mvs * sizeof(*mvs));
+    if (!sd)
+        return AVERROR(ENOMEM);
+    mvs = (AVMotionVector *)sd->data;
+
+    /* macroblocks are stored in coding order, which is bottom-up for
+     * flipped streams, and vertical motion is then inverted as well */
+    for (mb_row = 0; mb_row < s->mb_height; mb_row++) {
+        int y = (s->flip < 0 ? s->mb_height - mb_row - 1 : mb_row) * 16;
+
+        for (mb_col = 0; mb_col < s->mb_width; mb_col++) {
+            int mb = mb_row * s->mb_width + mb_col;
+            int type = s->macroblocks[mb].type;
+            int nb_blocks = type == VP56_MB_INTER_4V ? 4 : 1;
+            int size = type == VP56_MB_INTER_4V ? 8 : 16;
+
+            if (type == VP56_MB_INTRA)
+                continue;
+
+            for (b = 0; b < nb_blocks; b++) {
+                const VP56mv *mv = nb_blocks > 1 ? &s->block_mvs[mb][b]
+                                                 : &s->macroblocks[mb].mv;
+                int by = b >> 1;
+
+                if (s->flip < 0 && nb_blocks > 1)
+                    by ^= 1;
+                mvs->source       = -1;
+                mvs->w            = size;
+                mvs->h            = size;
+                mvs->dst_x        = mb_col * 16 + (b & 1) * 8 + size / 2;
+                mvs->dst_y        = y + by * 8 + size / 2;
+                mvs->motion_x     = mv->x;
+                mvs->motion_y     = mv->y * s->flip;
+                mvs->motion_scale = scale;
+                mvs->src_x        = mvs->dst_x + mvs->motion_x / scale;
+                mvs->src_y        = mvs->dst_y + mvs->motion_y / scale;
+                mvs->flags        = 0;
+                mvs++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int vp56_export_mvs_compact(VP56Context *s, AVFrame *frame)
+{
+    AVMotionVectorsCompact *mvc;
+    int16_t *mv_x, *mv_y;
+    int8_t *ref;
+    int mb_row, mb_col, b, nb_mvs = 0;
+
+    mvc = av_motion_vectors_compact_create_side_data(frame, s->mb_width * 2,
+                                                     s->mb_height * 2, 1);
+    if (!mvc)
+        return AVERROR(ENOMEM);
+    mvc->block_w      = 8;
+    mvc->block_h      = 8;
+    mvc->motion_scale = s->vp56_coord_div[0];
+
+    mv_x = av_motion_vectors_compact_mv_x(mvc, 0);
+    mv_y = av_motion_vectors_compact_mv_y(mvc, 0);
+    ref  = av_motion_vectors_compact_ref(mvc, 0);
+
+    /* same orientation handling as vp56_export_mvs() */
+    for (mb_row = 0; mb_row < s->mb_height; mb_row++) {
+        int y = (s->flip < 0 ? s->mb_height - mb_row - 1 : mb_row) * 2;
+
+        for (mb_col = 0; mb_col < s->mb_width; mb_col++) {
+            int mb = mb_row * s->mb_width + mb_col;
+            int type = s->macroblocks[mb].type;
+
+            if (type == VP56_MB_INTRA)
+                continue;
+
+            for (b = 0; b < 4; b++) {
+                const VP56mv *mv = type == VP56_MB_INTER_4V ? &s->block_mvs[mb][b]
+                                                            : &s->macroblocks[mb].mv;
+                int by  = s->flip < 0 ? (b >> 1) ^ 1 : b >> 1;
+                int idx = (y + by) * mvc->nb_blocks_x + mb_col * 2 + (b & 1);
+
+                mv_x[idx] = mv->x;
+                mv_y[idx] = mv->y * s->flip;
+                ref[idx]  = ff_vp56_reference_frame[type] - VP56_FRAME_PREVIOUS;
+            }
+            nb_mvs++;
+        }
+    }
+
+    /* like the other motion vector side data, omitted without vectors */
+    if (!nb_mvs)
+        av_frame_remove_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS_COMPACT);
+
+    return 0;
+}
+
 int ff_vp56_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
                          AVPacket *avpkt)
 {
@@ -651,6 +777,14 @@ int ff_vp56_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
 
     if ((res = av_frame_ref(data, p)) < 0)
         return res;
+    if (s->block_mvs && !p->key_frame) {
+        if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS &&
+            (res = vp56_export_mvs(s, data)) < 0)
+            return res;
+        if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_COMPACT &&
+            (res = vp56_export_mvs_compact(s, data)) < 0)
+            return res;
+    }
     *got_frame = 1;
 
     return avpkt->size;
@@ -844,6 +978,7 @@ av_cold int ff_vp56_free_context(VP56Context *s)
 
     av_freep(&s->above_blocks);
     av_freep(&s->macroblocks);
+    av_freep(&s->block_mvs);
     av_freep(&s->edge_emu_buffer_alloc);
 
     for (i = 0; i < FF_ARRAY_ELEMS(s->frames); i++)
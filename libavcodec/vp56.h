@@ -165,6 +165,7 @@ struct vp56_context {
     VP56mv mv[6];  /* vectors for each block in MB */
     VP56mv vector_candidate[2];
     int vector_candidate_pos;
+    VP56mv (*block_mvs)[4]; /* luma vectors of each MB, only allocated when exporting them */
 
     /* filtering hints */
     int filter_header;               /* used in vp6 only */
@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/imgutils.h"
+#include "libavutil/motion_vector.h"
 
 #include "avcodec.h"
 #include "hwconfig.h"
@@ -60,6 +61,7 @@ static void free_buffers(VP8Context *s)
         }
     av_freep(&s->thread_data);
     av_freep(&s->macroblocks_base);
+    av_freep(&s->mvs_macroblocks);
     av_freep(&s->intra4x4_pred_mode_top);
     av_freep(&s->top_nnz);
     av_freep(&s->top_border);
@@ -220,9 +222,15 @@ int update_dimensions(VP8Context *s, int width, int height, int is_vp7)
     s->top_nnz     = av_mallocz(s->mb_width * sizeof(*s->top_nnz));
     s->top_border  = av_mallocz((s->mb_width + 1) * sizeof(*s->top_border));
     s->thread_data = av_mallocz(MAX_THREADS * sizeof(VP8ThreadData));
+    if (avctx->export_side_data & (AV_CODEC_EXPORT_DATA_MVS |
+                                   AV_CODEC_EXPORT_DATA_MVS_COMPACT))
+        s->mvs_macroblocks = av_malloc_array(s->mb_width * s->mb_height,
+                                             sizeof(*s->mvs_macroblocks));
 
     if (!s->macroblocks_base || !s->top_nnz || !s->top_border ||
-        !s->thread_data || (!s->intra4x4_pred_mode_top && !s->mb_layout)) {
+        !s->thread_data || (!s->intra4x4_pred_mode_top && !s->mb_layout) ||
+        (!s->mvs_macroblocks && avctx->export_side_data & (AV_CODEC_EXPORT_DATA_MVS |
+                                                           AV_CODEC_EXPORT_DATA_MVS_COMPACT))) {
         free_buffers(s);
         return AVERROR(ENOMEM);
     }
@@ -2431,6 +2439,9 @@ static av_always_inline int decode_mb_row_no_filter(AVCodecContext *avctx, void
                            prev_frame && prev_frame->seg_map ?
                            prev_frame->seg_map->data + mb_xy : NULL, 0, is_vp7);
 
+        if (s->mvs_macroblocks)
+            s->mvs_macroblocks[mb_xy] = *mb;
+
         prefetch_motion(s, mb, mb_x, mb_y, mb_xy, VP56_FRAME_PREVIOUS);
 
         if (!mb->skip)
@@ -2616,6 +2627,115 @@ static int vp8_decode_mb_row_sliced(AVCodecContext *avctx, void *tdata,
     return vp78_decode_mb_row_sliced(avctx, tdata, jobnr, threadnr, IS_VP8);
 }
 
+static int vp8_export_mvs(VP8Context *s, AVFrame *frame)
+{
+    /* partition sizes in 4x4 blocks, indexed by VP8_SPLITMVMODE_* */
+    static const uint8_t split_w[4] = { 4, 2, 2, 1 };
+    static const uint8_t split_h[4] = { 2, 4, 2, 1 };
+    AVFrameSideData *sd;
+    AVMotionVector *mvs;
+    int mb_x, mb_y, n, nb_mvs = 0;
+
+    for (n = 0; n < s->mb_width * s->mb_height; n++) {
+        const VP8Macroblock *mb = &s->mvs_macroblocks[n];
+        if (mb->mode == VP8_MVMODE_SPLIT)
+            nb_mvs += 16 / (split_w[mb->partitioning] * split_h[mb->partitioning]);
+        else if (mb->mode > MODE_I4x4)
+            nb_mvs++;
+    }
+
+    if (!nb_mvs)
+        return 0;
+
+    sd = av_frame_new_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS,
+                                nb_mvs * sizeof(*mvs));
+    if (!sd)
+        return AVERROR(ENOMEM);
+    mvs = (AVMotionVector *)sd->data;
+
+    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
+        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+            const VP8Macroblock *mb = &s->mvs_macroblocks[mb_y * s->mb_width + mb_x];
+            int w = 16, h = 16, nb_parts = 1;
+
+            if (mb->mode <= MODE_I4x4)
+                continue;
+            if (mb->mode == VP8_MVMODE_SPLIT) {
+                w        = split_w[mb->partitioning] * 4;
+                h        = split_h[mb->partitioning] * 4;
+                nb_parts = 256 / (w * h);
+            }
+
+            for (n = 0; n < nb_parts; n++) {
+                const VP56mv *mv = nb_parts > 1 ? &mb->bmv[n] : &mb->mv;
+                mvs->source       = -1;
+                mvs->w            = w;
+                mvs->h            = h;
+                mvs->dst_x        = mb_x * 16 + (n % (16 / w)) * w + (w >> 1);
+                mvs->dst_y        = mb_y * 16 + (n / (16 / w)) * h + (h >> 1);
+                mvs->motion_x     = mv->x;
+                mvs->motion_y     = mv->y;
+                mvs->motion_scale = 4;
+                mvs->src_x        = mvs->dst_x + mvs->motion_x / 4;
+                mvs->src_y        = mvs->dst_y + mvs->motion_y / 4;
+                mvs->flags        = 0;
+                mvs++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int vp8_export_mvs_compact(VP8Context *s, AVFrame *frame)
+{
+    AVMotionVectorsCompact *mvc;
+    int16_t *mv_x, *mv_y;
+    int8_t *ref;
+    int mb_x, mb_y, x, y, nb_mvs = 0;
+
+    mvc = av_motion_vectors_compact_create_side_data(frame, s->mb_width * 4,
+                                                     s->mb_height * 4, 1);
+    if (!mvc)
+        return AVERROR(ENOMEM);
+    mvc->block_w      = 4;
+    mvc->block_h      = 4;
+    mvc->motion_scale = 4;
+
+    mv_x = av_motion_vectors_compact_mv_x(mvc, 0);
+    mv_y = av_motion_vectors_compact_mv_y(mvc, 0);
+    ref  = av_motion_vectors_compact_ref(mvc, 0);
+
+    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
+        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+            const VP8Macroblock *mb = &s->mvs_macroblocks[mb_y * s->mb_width + mb_x];
+
+            if (mb->mode <= MODE_I4x4)
+                continue;
+
+            for (y = 0; y < 4; y++) {
+                for (x = 0; x < 4; x++) {
+                    int idx = (mb_y * 4 + y) * mvc->nb_blocks_x + mb_x * 4 + x;
+                    const VP56mv *mv = mb->mode == VP8_MVMODE_SPLIT ?
+                                       &mb->bmv[vp8_mbsplits[mb->partitioning][y * 4 + x]] :
+                                       &mb->mv;
+
+                    mv_x[idx] = mv->x;
+                    mv_y[idx] = mv->y;
+                    ref[idx]  = mb->ref_frame - VP56_FRAME_PREVIOUS;
+                }
+            }
+            nb_mvs++;
+        }
+    }
+
+    /* like the other motion vector side data, omitted without vectors */
+    if (!nb_mvs)
+        av_frame_remove_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS_COMPACT);
+
+    return 0;
+}
+
 static av_always_inline
 int vp78_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
                       AVPacket *avpkt, int is_vp7)
@@ -2794,6 +2914,14 @@ skip_decode:
     if (!s->invisible) {
         if ((ret = av_frame_ref(data, curframe->tf.f)) < 0)
             return ret;
+        if (s->mvs_macroblocks && !avctx->hwaccel && !s->keyframe) {
+            if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS &&
+                (ret = vp8_export_mvs(s, data)) < 0)
+                return ret;
+            if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_COMPACT &&
+                (ret = vp8_export_mvs_compact(s, data)) < 0)
+                return ret;
+        }
         *got_frame = 1;
     }
 
@@ -280,6 +280,13 @@ typedef struct VP8Context {
     } prob[2];
 
     VP8Macroblock *macroblocks_base;
+
+    /**
+     * Full-frame copy of the decoded macroblock modes, only allocated
+     * when motion vectors are exported.
+     */
+    VP8Macroblock *mvs_macroblocks;
+
     int invisible;
     int update_last;    ///< update VP56_FRAME_PREVIOUS with the current one
     int update_golden;  ///< VP56_FRAME_NONE if not updated, or which frame to copy if so
@@ -33,6 +33,7 @@
 #include "vp9data.h"
 #include "vp9dec.h"
 #include "libavutil/avassert.h"
+#include "libavutil/motion_vector.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/video_enc_params.h"
 
@@ -329,7 +330,8 @@ static int update_block_buffers(AVCodecContext *avctx)
         td->uveob_base[0] = td->eob_base + 16 * 16 * sbs;
         td->uveob_base[1] = td->uveob_base[0] + chroma_eobs * sbs;
 
-        if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS) {
+        if (avctx->export_side_data & (AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS |
+                                       AV_CODEC_EXPORT_DATA_MVS)) {
             td->block_structure = av_malloc_array(s->cols * s->rows, sizeof(*td->block_structure));
             if (!td->block_structure)
                 return AVERROR(ENOMEM);
@@ -350,7 +352,8 @@ static int update_block_buffers(AVCodecContext *avctx)
             s->td[i].uveob_base[0] = s->td[i].eob_base + 16 * 16;
             s->td[i].uveob_base[1] = s->td[i].uveob_base[0] + chroma_eobs;
 
-            if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS) {
+            if (avctx->export_side_data & (AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS |
+                                           AV_CODEC_EXPORT_DATA_MVS)) {
                 s->td[i].block_structure = av_malloc_array(s->cols * s->rows, sizeof(*td->block_structure));
                 if (!s->td[i].block_structure)
                     return AVERROR(ENOMEM);
@@ -1548,6 +1551,111 @@ static int vp9_export_enc_params(VP9Context *s, VP9Frame *frame)
     return 0;
 }
 
+static int vp9_export_mvs(VP9Context *s, VP9Frame *frame)
+{
+    AVFrameSideData *sd;
+    AVMotionVector *mvs;
+    unsigned int tile, block, nb_mvs = 0;
+
+    /* One vector per coded block and reference; the per-8x8 entries of
+     * frame->mv that a block covers are all identical, so only its top-left
+     * entry is read. */
+    for (tile = 0; tile < s->active_tile_cols; tile++) {
+        VP9TileData *td = &s->td[tile];
+
+        for (block = 0; block < td->nb_block_structure; block++) {
+            const VP9mvrefPair *mv = &frame->mv[td->block_structure[block].row * s->sb_cols * 8 +
+                                                td->block_structure[block].col];
+            nb_mvs += (mv->ref[0] >= 0) + (mv->ref[1] >= 0);
+        }
+    }
+
+    if (!nb_mvs)
+        return 0;
+
+    sd = av_frame_new_side_data(frame->tf.f, AV_FRAME_DATA_MOTION_VECTORS,
+                                nb_mvs * sizeof(*mvs));
+    if (!sd)
+        return AVERROR(ENOMEM);
+    mvs = (AVMotionVector *)sd->data;
+
+    for (tile = 0; tile < s->active_tile_cols; tile++) {
+        VP9TileData *td = &s->td[tile];
+
+        for (block = 0; block < td->nb_block_structure; block++) {
+            unsigned int row = td->block_structure[block].row;
+            unsigned int col = td->block_structure[block].col;
+            int w = 8 << td->block_structure[block].block_size_idx_x;
+            int h = 8 << td->block_structure[block].block_size_idx_y;
+            const VP9mvrefPair *mv = &frame->mv[row * s->sb_cols * 8 + col];
+            int i;
+
+            for (i = 0; i < 2; i++) {
+                if (mv->ref[i] < 0)
+                    continue;
+                /* compound prediction also uses past references only */
+                mvs->source       = -1;
+                mvs->w            = w;
+                mvs->h            = h;
+                mvs->dst_x        = col * 8 + (w >> 1);
+                mvs->dst_y        = row * 8 + (h >> 1);
+                mvs->motion_x     = mv->mv[i].x;
+                mvs->motion_y     = mv->mv[i].y;
+                mvs->motion_scale = 8;
+                mvs->src_x        = mvs->dst_x + mvs->motion_x / 8;
+                mvs->src_y        = mvs->dst_y + mvs->motion_y / 8;
+                mvs->flags        = mv->ref[1] >= 0 ? AV_MOTION_VECTOR_FLAG_BIPRED : 0;
+                mvs++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int vp9_export_mvs_compact(VP9Context *s, VP9Frame *frame)
+{
+    AVMotionVectorsCompact *mvc;
+    int row, col, i, nb_mvs = 0;
+
+    if (s->s.h.keyframe || s->s.h.intraonly)
+        return 0;
+
+    mvc = av_motion_vectors_compact_create_side_data(frame->tf.f, s->cols, s->rows, 2);
+    if (!mvc)
+        return AVERROR(ENOMEM);
+    mvc->block_w      = 8;
+    mvc->block_h      = 8;
+    mvc->motion_scale = 8;
+
+    for (i = 0; i < 2; i++) {
+        int16_t *mv_x = av_motion_vectors_compact_mv_x(mvc, i);
+        int16_t *mv_y = av_motion_vectors_compact_mv_y(mvc, i);
+        int8_t  *ref  = av_motion_vectors_compact_ref(mvc, i);
+
+        for (row = 0; row < s->rows; row++) {
+            const VP9mvrefPair *mv = &frame->mv[row * s->sb_cols * 8];
+
+            for (col = 0; col < s->cols; col++) {
+                int idx = row * s->cols + col;
+
+                if (mv[col].ref[i] < 0)
+                    continue;
+                mv_x[idx] = mv[col].mv[i].x;
+                mv_y[idx] = mv[col].mv[i].y;
+                ref[idx]  = mv[col].ref[i];
+                nb_mvs++;
+            }
+        }
+    }
+
+    /* like the other motion vector side data, omitted without vectors */
+    if (!nb_mvs)
+        av_frame_remove_side_data(frame->tf.f, AV_FRAME_DATA_MOTION_VECTORS_COMPACT);
+
+    return 0;
+}
+
 static int vp9_decode_frame(AVCodecContext *avctx, void *frame,
                             int *got_frame, AVPacket *pkt)
 {
@@ -1761,6 +1869,16 @@ FF_ENABLE_DEPRECATION_WARNINGS
         if (ret < 0)
             return ret;
     }
+    if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS) {
+        ret = vp9_export_mvs(s, &s->s.frames[CUR_FRAME]);
+        if (ret < 0)
+            return ret;
+    }
+    if (avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS_COMPACT) {
+        ret = vp9_export_mvs_compact(s, &s->s.frames[CUR_FRAME]);
+        if (ret < 0)
+            return ret;
+    }
 
 finish:
     // ref frame setup
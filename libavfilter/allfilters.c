@@ -300,6 +300,9 @@ extern AVFilter ff_vf_midequalizer;
 extern AVFilter ff_vf_minterpolate;
 extern AVFilter ff_vf_mix;
 extern AVFilter ff_vf_mpdecimate;
+extern AVFilter ff_vf_mvdump;
+extern AVFilter ff_vf_mvstats;
+extern AVFilter ff_vf_mvtrack;
 extern AVFilter ff_vf_negate;
 extern AVFilter ff_vf_nlmeans;
 extern AVFilter ff_vf_nlmeans_opencl;
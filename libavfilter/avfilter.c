@@ -190,9 +190,27 @@ int avfilter_link_get_channels(AVFilterLink *link)
 }
 #endif
 
+/**
+ * Lock the scheduling state of a filter that may be the neighbour of several
+ * filters being activated concurrently.
+ */
+static void lock_state(AVFilterContext *filter)
+{
+    if (filter->graph && filter->graph->internal->concurrent)
+        ff_mutex_lock(&filter->graph->internal->state_lock);
+}
+
+static void unlock_state(AVFilterContext *filter)
+{
+    if (filter->graph && filter->graph->internal->concurrent)
+        ff_mutex_unlock(&filter->graph->internal->state_lock);
+}
+
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
+    lock_state(filter);
     filter->ready = FFMAX(filter->ready, priority);
+    unlock_state(filter);
 }
 
 /**
@@ -203,8 +221,10 @@ static void filter_unblock(AVFilterContext *filter)
 {
     unsigned i;
 
+    lock_state(filter);
     for (i = 0; i < filter->nb_outputs; i++)
         filter->outputs[i]->frame_blocked_in = 0;
+    unlock_state(filter);
 }
 
 
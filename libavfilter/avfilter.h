@@ -331,6 +331,11 @@ typedef struct AVFilter {
  * Process multiple parts of the frame concurrently.
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
+/**
+ * Activate independent filters of the graph concurrently. Only used in
+ * AVFilterGraph.thread_type, and not enabled by default.
+ */
+#define AVFILTER_THREAD_GRAPH (1 << 1)
 
 typedef struct AVFilterInternal AVFilterInternal;
 
@@ -50,6 +50,7 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "graph", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_GRAPH }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
@@ -95,6 +96,11 @@ AVFilterGraph *avfilter_graph_alloc(void)
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
+    if (ff_mutex_init(&ret->internal->state_lock, NULL)) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
 
     return ret;
 }
@@ -135,6 +141,7 @@ void avfilter_graph_free(AVFilterGraph **graph)
     av_freep(&(*graph)->resample_lavr_opts);
 #endif
     av_freep(&(*graph)->filters);
+    ff_mutex_destroy(&(*graph)->internal->state_lock);
     av_freep(&(*graph)->internal);
     av_freep(graph);
 }
@@ -1441,6 +1448,112 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+/* maximum number of filters activated concurrently */
+#define MAX_CONCURRENT 16
+
+/* scheduling marks */
+#define MARK_ACTIVE        1    ///< activated in this round
+#define MARK_FEEDS_ACTIVE  2    ///< has an output to an activated filter
+#define MARK_FED_BY_ACTIVE 4    ///< has an input from an activated filter
+
+static int get_marks(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    return filter->internal->round == graph->internal->round ?
+           filter->internal->marks : 0;
+}
+
+static void add_marks(AVFilterGraph *graph, AVFilterContext *filter, int marks)
+{
+    if (filter->internal->round != graph->internal->round) {
+        filter->internal->round = graph->internal->round;
+        filter->internal->marks = 0;
+    }
+    filter->internal->marks |= marks;
+}
+
+static int can_run_concurrently(AVFilterContext *filter)
+{
+    /* sinks update the heap of the sink links shared by the whole graph */
+    return filter->nb_outputs &&
+           !(filter->filter->flags_internal & FF_FILTER_FLAG_GRAPH_ACCESS);
+}
+
+/**
+ * Tell if a filter can be activated together with the filters already
+ * marked active.
+ *
+ * Activating a filter changes the state of its links and the scheduling
+ * state of its neighbours. So it must not be linked to an active filter, nor
+ * be linked to both sides of a neighbour of one. Filters sharing the same
+ * source or destination are fine, the state they share is locked.
+ */
+static int is_independent(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    unsigned i;
+
+    if (get_marks(graph, filter))
+        return 0;
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i] &&
+            get_marks(graph, filter->outputs[i]->dst) & MARK_FEEDS_ACTIVE)
+            return 0;
+    for (i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i] &&
+            get_marks(graph, filter->inputs[i]->src) & MARK_FED_BY_ACTIVE)
+            return 0;
+    return 1;
+}
+
+static void mark_active(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    unsigned i;
+
+    add_marks(graph, filter, MARK_ACTIVE);
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i])
+            add_marks(graph, filter->outputs[i]->dst, MARK_FED_BY_ACTIVE);
+    for (i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i])
+            add_marks(graph, filter->inputs[i]->src, MARK_FEEDS_ACTIVE);
+}
+
+/**
+ * Activate the given filter together with the other ready filters that are
+ * independent from it.
+ */
+static int run_concurrently(AVFilterGraph *graph, AVFilterContext *first)
+{
+    AVFilterContext *filters[MAX_CONCURRENT];
+    int rets[MAX_CONCURRENT];
+    int nb_filters = 1, max_filters = FFMIN(graph->nb_threads, MAX_CONCURRENT);
+    unsigned i;
+    int ret;
+
+    graph->internal->round++;
+    filters[0] = first;
+    mark_active(graph, first);
+    for (i = 0; i < graph->nb_filters && nb_filters < max_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (filter->ready && can_run_concurrently(filter) &&
+            is_independent(graph, filter)) {
+            filters[nb_filters++] = filter;
+            mark_active(graph, filter);
+        }
+    }
+
+    if (nb_filters == 1)
+        return ff_filter_activate(first);
+
+    ret = graph->internal->thread_activate(graph, filters, rets, nb_filters);
+    if (ret < 0)
+        return ret;
+    for (i = 0; i < nb_filters; i++)
+        if (rets[i] < 0)
+            return rets[i];
+    return 0;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
     AVFilterContext *filter;
@@ -1453,5 +1566,7 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
             filter = graph->filters[i];
     if (!filter->ready)
         return AVERROR(EAGAIN);
+    if (graph->internal->thread_activate && can_run_concurrently(filter))
+        return run_concurrently(graph, filter);
     return ff_filter_activate(filter);
 }
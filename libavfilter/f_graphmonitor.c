@@ -393,6 +393,7 @@ AVFilter ff_vf_graphmonitor = {
     .activate      = activate,
     .inputs        = graphmonitor_inputs,
     .outputs       = graphmonitor_outputs,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_ACCESS,
 };
 
 #endif // CONFIG_GRAPHMONITOR_FILTER
@@ -428,5 +429,6 @@ AVFilter ff_avf_agraphmonitor = {
     .activate      = activate,
     .inputs        = agraphmonitor_inputs,
     .outputs       = agraphmonitor_outputs,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_ACCESS,
 };
 #endif // CONFIG_AGRAPHMONITOR_FILTER
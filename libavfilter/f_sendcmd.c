@@ -605,6 +605,7 @@ AVFilter ff_vf_sendcmd = {
     .priv_size   = sizeof(SendCmdContext),
     .inputs      = sendcmd_inputs,
     .outputs     = sendcmd_outputs,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_ACCESS,
     .priv_class  = &sendcmd_class,
 };
 
@@ -640,6 +641,7 @@ AVFilter ff_af_asendcmd = {
     .priv_size   = sizeof(SendCmdContext),
     .inputs      = asendcmd_inputs,
     .outputs     = asendcmd_outputs,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_ACCESS,
     .priv_class  = &asendcmd_class,
 };
 
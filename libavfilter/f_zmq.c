@@ -233,6 +233,7 @@ AVFilter ff_vf_zmq = {
     .priv_size   = sizeof(ZMQContext),
     .inputs      = zmq_inputs,
     .outputs     = zmq_outputs,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_ACCESS,
     .priv_class  = &zmq_class,
 };
 
@@ -268,6 +269,7 @@ AVFilter ff_af_azmq = {
     .priv_size   = sizeof(ZMQContext),
     .inputs      = azmq_inputs,
     .outputs     = azmq_outputs,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_ACCESS,
     .priv_class  = &azmq_class,
 };
 
@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "framepool.h"
@@ -137,11 +138,29 @@ struct AVFilterPad {
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
+    /**
+     * Activate the given filters concurrently and store the return values
+     * in rets. Set when AVFILTER_THREAD_GRAPH is used.
+     */
+    int (*thread_activate)(AVFilterGraph *graph, AVFilterContext **filters,
+                           int *rets, int nb_filters);
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Set while filters are activated concurrently. The filters activated
+     * together are never linked to each other, but they may share neighbours,
+     * whose scheduling state is then protected by state_lock.
+     */
+    int concurrent;
+    AVMutex state_lock;
+    unsigned round;                     ///< counter of the concurrent activations
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+    /* scheduling marks, only valid if round matches the one of the graph */
+    unsigned round;
+    int marks;
 };
 
 /**
@@ -364,6 +383,12 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter accesses other filters of the graph than its neighbours, so it
+ * must not be activated concurrently with other filters.
+ */
+#define FF_FILTER_FLAG_GRAPH_ACCESS (1 << 1)
+
 /**
  * Run one round of processing on a filter graph.
  */
@@ -18,6 +18,10 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/common.h"
+#include "libavutil/log.h"
+#include "libavutil/motion_vector.h"
+
 #include "motion_estimation.h"
 
 static const int8_t sqr1[8][2]  = {{ 0,-1}, { 0, 1}, {-1, 0}, { 1, 0}, {-1,-1}, {-1, 1}, { 1,-1}, { 1, 1}};
@@ -45,6 +49,8 @@ if (x >= x_min && x <= x_max && y >= y_min && y <= y_max)\
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max)
 {
+    int i;
+
     me_ctx->width = width;
     me_ctx->height = height;
     me_ctx->mb_size = mb_size;
@@ -54,6 +60,9 @@ void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_para
     me_ctx->x_max = x_max;
     me_ctx->y_min = y_min;
     me_ctx->y_max = y_max;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(me_ctx->sad); i++)
+        me_ctx->sad[i] = av_pixelutils_get_sad_fn(i, i, 0, NULL);
 }
 
 uint64_t ff_me_cmp_sad(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int x_mv, int y_mv)
@@ -61,12 +70,16 @@ uint64_t ff_me_cmp_sad(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int x_mv,
     const int linesize = me_ctx->linesize;
     uint8_t *data_ref = me_ctx->data_ref;
     uint8_t *data_cur = me_ctx->data_cur;
+    av_pixelutils_sad_fn sad_fn = ff_me_get_sad_fn(me_ctx, me_ctx->mb_size);
     uint64_t sad = 0;
     int i, j;
 
     data_ref += y_mv * linesize;
     data_cur += y_mb * linesize;
 
+    if (sad_fn)
+        return sad_fn(data_cur + x_mb, linesize, data_ref + x_mv, linesize);
+
     for (j = 0; j < me_ctx->mb_size; j++)
         for (i = 0; i < me_ctx->mb_size; i++)
             sad += FFABS(data_ref[x_mv + i + j * linesize] - data_cur[x_mb + i + j * linesize]);
@@ -430,3 +443,114 @@ uint64_t ff_me_search_umh(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int *m
 
     return cost_min;
 }
+
+uint64_t ff_me_search_refine(AVMotionEstContext *me_ctx, int x_mb, int y_mb,
+                             int cand_x, int cand_y, int *mv)
+{
+    AVMotionEstPredictor *preds = me_ctx->preds;
+
+    preds[0].mvs[0][0] = cand_x;
+    preds[0].mvs[0][1] = cand_y;
+    preds[0].mvs[1][0] = 0;
+    preds[0].mvs[1][1] = 0;
+    preds[0].nb = 2;
+    preds[1].nb = 0;
+
+    return ff_me_search_epzs(me_ctx, x_mb, y_mb, mv);
+}
+
+int ff_me_get_decoder_mvs(const AVFrame *frame, AVMotionEstDecoderMV *dec_mvs,
+                          int b_width, int b_height, int log2_mb_size, int poc_step)
+{
+    const AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+    const AVFrameSideData *sd_ext = NULL;
+    size_t stride = sizeof(AVMotionVector);
+    int nb_mvs, count = 0;
+    int i, mb_x, mb_y, dir;
+
+    memset(dec_mvs, 0, b_width * b_height * sizeof(*dec_mvs));
+
+    if (poc_step > 0)
+        sd_ext = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS_EXT);
+    if (sd_ext && sd_ext->size >= sizeof(AVMotionVectorExt) &&
+        ((const AVMotionVectorExt *)sd_ext->data)->self_size >= sizeof(AVMotionVectorExt)) {
+        sd     = sd_ext;
+        stride = ((const AVMotionVectorExt *)sd_ext->data)->self_size;
+    } else {
+        sd_ext = NULL;
+    }
+
+    if (!sd)
+        return 0;
+
+    nb_mvs = sd->size / stride;
+
+    for (i = 0; i < nb_mvs; i++) {
+        const uint8_t *entry = sd->data + i * stride;
+        const AVMotionVectorExt *ext = sd_ext ? (const AVMotionVectorExt *)entry : NULL;
+        const AVMotionVector *mv = ext ? &ext->mv : (const AVMotionVector *)entry;
+        int x, y, mb_x_end, mb_y_end;
+        int mv_x, mv_y, dist;
+
+        /* the signed distance to the reference in frames: the POC distance
+         * of the extended vectors if known, else the source, which most
+         * decoders only set to the direction */
+        dist = mv->source;
+        if (ext && ext->poc_delta != INT32_MIN) {
+            if (ext->poc_delta % poc_step)
+                continue;
+            dist = ext->poc_delta / poc_step;
+        }
+        if (!dist)
+            continue;
+        dir = dist > 0;
+
+        x = mv->dst_x - mv->w / 2;
+        y = mv->dst_y - mv->h / 2;
+        mb_x_end = FFMIN((x + mv->w - 1) >> log2_mb_size, b_width  - 1);
+        mb_y_end = FFMIN((y + mv->h - 1) >> log2_mb_size, b_height - 1);
+
+        /* accumulated in 1/16 pel, scaled to the adjacent frame */
+        if (mv->motion_scale) {
+            mv_x = mv->motion_x * 16 / mv->motion_scale;
+            mv_y = mv->motion_y * 16 / mv->motion_scale;
+        } else {
+            mv_x = (mv->src_x - mv->dst_x) * 16;
+            mv_y = (mv->src_y - mv->dst_y) * 16;
+        }
+        mv_x = ROUNDED_DIV(mv_x, FFABS(dist));
+        mv_y = ROUNDED_DIV(mv_y, FFABS(dist));
+
+        for (mb_y = FFMAX(y, 0) >> log2_mb_size; mb_y <= mb_y_end; mb_y++)
+            for (mb_x = FFMAX(x, 0) >> log2_mb_size; mb_x <= mb_x_end; mb_x++) {
+                AVMotionEstDecoderMV *dec = &dec_mvs[mb_x + mb_y * b_width];
+
+                dec->mvs[dir][0] += mv_x;
+                dec->mvs[dir][1] += mv_y;
+                dec->nb[dir]++;
+            }
+    }
+
+    for (i = 0; i < b_width * b_height; i++) {
+        AVMotionEstDecoderMV *dec = &dec_mvs[i];
+
+        for (dir = 0; dir < 2; dir++)
+            if (dec->nb[dir]) {
+                dec->mvs[dir][0] = ROUNDED_DIV(dec->mvs[dir][0], 16 * dec->nb[dir]);
+                dec->mvs[dir][1] = ROUNDED_DIV(dec->mvs[dir][1], 16 * dec->nb[dir]);
+            }
+        count += dec->nb[0] || dec->nb[1];
+    }
+
+    return count;
+}
+
+void ff_me_warn_no_decoder_mvs(void *log_ctx, int *warned, int ext)
+{
+    if (*warned)
+        return;
+    av_log(log_ctx, AV_LOG_WARNING, "No %smotion vectors exported by the decoder, "
+           "use -flags2 +export_mvs%s\n", ext ? "extended " : "",
+           ext ? " -export_side_data +mvs_ext" : "");
+    *warned = 1;
+}
@@ -22,6 +22,8 @@
 #define AVFILTER_MOTION_ESTIMATION_H
 
 #include "libavutil/avutil.h"
+#include "libavutil/frame.h"
+#include "libavutil/pixelutils.h"
 
 #define AV_ME_METHOD_ESA        1
 #define AV_ME_METHOD_TSS        2
@@ -33,11 +35,23 @@
 #define AV_ME_METHOD_EPZS       8
 #define AV_ME_METHOD_UMH        9
 
+#define AV_ME_SOURCE_ESTIMATE   0   ///< search the motion vectors
+#define AV_ME_SOURCE_DECODER    1   ///< refine the motion vectors exported by the decoder
+#define AV_ME_SOURCE_HYBRID     2   ///< search, trying the decoder motion vectors too
+
 typedef struct AVMotionEstPredictor {
     int mvs[10][2];
     int nb;
 } AVMotionEstPredictor;
 
+/**
+ * Motion vectors exported by the decoder for one block of the search grid.
+ */
+typedef struct AVMotionEstDecoderMV {
+    int mvs[2][2];  ///< full-pel vectors to the past and future references
+    int nb[2];      ///< number of decoder vectors averaged in mvs, 0 if none
+} AVMotionEstDecoderMV;
+
 typedef struct AVMotionEstContext {
     uint8_t *data_cur, *data_ref;
     int linesize;
@@ -57,10 +71,31 @@ typedef struct AVMotionEstContext {
     int pred_y;     ///< median predictor y
     AVMotionEstPredictor preds[2];
 
+    /**
+     * Optimized SAD of 1 << n wide square blocks, indexed by n, or NULL
+     * where av_pixelutils_get_sad_fn() has none. See ff_me_get_sad_fn().
+     */
+    av_pixelutils_sad_fn sad[6];
+
     uint64_t (*get_cost)(struct AVMotionEstContext *me_ctx, int x_mb, int y_mb,
                          int mv_x, int mv_y);
 } AVMotionEstContext;
 
+/**
+ * Get the optimized SAD of size x size blocks, or NULL if there is none.
+ * Cost functions must look it up for the current mb_size, which changes
+ * during variable size block matching. Sizes below 4 are left to the scalar
+ * loops: the overlapped window of a 1 pixel block is not 2x2 there.
+ */
+static inline av_pixelutils_sad_fn ff_me_get_sad_fn(const AVMotionEstContext *me_ctx, int size)
+{
+    int log2_size = av_log2(size);
+
+    if (size < 4 || size != 1 << log2_size || log2_size >= FF_ARRAY_ELEMS(me_ctx->sad))
+        return NULL;
+    return me_ctx->sad[log2_size];
+}
+
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max);
 
@@ -84,4 +119,41 @@ uint64_t ff_me_search_epzs(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int *
 
 uint64_t ff_me_search_umh(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int *mv);
 
+/**
+ * Refine the candidate vector (cand_x, cand_y), relative to the block, with
+ * a small diamond search. The zero vector and the median predictor are
+ * tried too. This overwrites the predictors of me_ctx.
+ */
+uint64_t ff_me_search_refine(AVMotionEstContext *me_ctx, int x_mb, int y_mb,
+                             int cand_x, int cand_y, int *mv);
+
+/**
+ * Map the AV_FRAME_DATA_MOTION_VECTORS side data of frame, as exported by
+ * the decoder, on a grid of b_width x b_height blocks of 1 << log2_mb_size
+ * pixels. The vectors of all the decoder blocks overlapping a block are
+ * averaged per direction.
+ *
+ * The vectors are divided by the distance in frames to their reference, so
+ * that they point to the adjacent frame the filters search. This distance is
+ * the absolute source of the vector, which most decoders only set to 1.
+ *
+ * @param poc_step if positive, the number of POC units between two frames:
+ *                 the AV_FRAME_DATA_MOTION_VECTORS_EXT side data is used
+ *                 instead when present, and the distance derived from the
+ *                 POC distance of each vector. Vectors whose POC distance is
+ *                 not a multiple of poc_step are dropped.
+ * @return the number of blocks with at least one decoder vector
+ */
+int ff_me_get_decoder_mvs(const AVFrame *frame, AVMotionEstDecoderMV *dec_mvs,
+                          int b_width, int b_height, int log2_mb_size, int poc_step);
+
+/**
+ * Warn once that the decoder does not export the motion vectors a filter
+ * needs.
+ *
+ * @param warned set once the warning has been printed, to not repeat it
+ * @param ext    whether the extended motion vectors are needed too
+ */
+void ff_me_warn_no_decoder_mvs(void *log_ctx, int *warned, int ext);
+
 #endif /* AVFILTER_MOTION_ESTIMATION_H */
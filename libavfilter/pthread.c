@@ -42,6 +42,12 @@ typedef struct ThreadContext {
     AVFilterContext *ctx;
     void *arg;
     int   *rets;
+
+    /* concurrent activation of filters, with AVFILTER_THREAD_GRAPH */
+    AVSliceThread *graph_thread;
+    AVMutex execute_lock;               ///< serializes the slice jobs of the active filters
+    AVFilterContext **active;
+    int *active_rets;
 } ThreadContext;
 
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
@@ -52,8 +58,19 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
         c->rets[jobnr] = ret;
 }
 
+static void graph_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ThreadContext *c = priv;
+
+    c->active_rets[jobnr] = ff_filter_activate(c->active[jobnr]);
+}
+
 static void slice_thread_uninit(ThreadContext *c)
 {
+    if (c->graph_thread) {
+        avpriv_slicethread_free(&c->graph_thread);
+        ff_mutex_destroy(&c->execute_lock);
+    }
     avpriv_slicethread_free(&c->thread);
 }
 
@@ -64,15 +81,46 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+    if (c->graph_thread)
+        ff_mutex_lock(&c->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    if (c->graph_thread)
+        ff_mutex_unlock(&c->execute_lock);
     return 0;
 }
 
+static int thread_activate(AVFilterGraph *graph, AVFilterContext **filters,
+                           int *rets, int nb_filters)
+{
+    ThreadContext *c = graph->internal->thread;
+
+    c->active      = filters;
+    c->active_rets = rets;
+
+    graph->internal->concurrent = 1;
+    avpriv_slicethread_execute(c->graph_thread, nb_filters, 0);
+    graph->internal->concurrent = 0;
+    return 0;
+}
+
+static void graph_thread_init(AVFilterGraph *graph, ThreadContext *c)
+{
+    if (ff_mutex_init(&c->execute_lock, NULL))
+        return;
+    if (avpriv_slicethread_create(&c->graph_thread, c, graph_worker_func,
+                                  NULL, graph->nb_threads) <= 1) {
+        avpriv_slicethread_free(&c->graph_thread);
+        ff_mutex_destroy(&c->execute_lock);
+        return;
+    }
+    graph->internal->thread_activate = thread_activate;
+}
+
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
     nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
@@ -104,6 +152,8 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads = ret;
 
     graph->internal->thread_execute = thread_execute;
+    if (graph->thread_type & AVFILTER_THREAD_GRAPH)
+        graph_thread_init(graph, graph->internal->thread);
 
     return 0;
 }
@@ -26,10 +26,16 @@
  * All the MV drawing code from Michael Niedermayer is extracted from
  * libavcodec/mpegvideo.c.
  *
+ * The frame is split into horizontal bands drawn by separate slice jobs.
+ * The vectors to draw are binned by the bands their arrow overlaps, and
+ * each job only draws the pixels of its own band, so the result does not
+ * depend on the number of jobs.
+ *
  * TODO: segmentation
  */
 
 #include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
 #include "libavutil/motion_vector.h"
 #include "libavutil/opt.h"
 #include "avfilter.h"
@@ -44,6 +50,10 @@
 #define FRAME_TYPE_P (1<<1)
 #define FRAME_TYPE_B (1<<2)
 
+#define MAX_BANDS 64
+/* distance the arrow head and the antialiasing can reach beyond the line ends */
+#define ARROW_MARGIN 4
+
 typedef struct CodecViewContext {
     const AVClass *class;
     unsigned mv;
@@ -51,6 +61,14 @@ typedef struct CodecViewContext {
     unsigned mv_type;
     int hsub, vsub;
     int qp;
+
+    /* vectors of the current frame binned per band: the indices of the
+     * vectors of band n are bin_idx[bin_start[n]] to bin_idx[bin_start[n + 1] - 1] */
+    int nb_bands, band_h;
+    int bin_start[MAX_BANDS + 1];
+    int *bin_idx;
+    unsigned int bin_idx_size;
+    const AVMotionVector *mvs;
 } CodecViewContext;
 
 #define OFFSET(x) offsetof(CodecViewContext, x)
@@ -110,14 +128,15 @@ static int clip_line(int *sx, int *sy, int *ex, int *ey, int maxx)
 }
 
 /**
- * Draw a line from (ex, ey) -> (sx, sy).
+ * Draw a line from (ex, ey) -> (sx, sy), only touching the rows from y0 to
+ * y1 - 1.
  * @param w width of the image
  * @param h height of the image
  * @param stride stride/linesize of the image
  * @param color color of the arrow
  */
 static void draw_line(uint8_t *buf, int sx, int sy, int ex, int ey,
-                      int w, int h, int stride, int color)
+                      int w, int h, int stride, int color, int y0, int y1)
 {
     int x, y, fr, f;
 
@@ -131,7 +150,8 @@ static void draw_line(uint8_t *buf, int sx, int sy, int ex, int ey,
     ex = av_clip(ex, 0, w - 1);
     ey = av_clip(ey, 0, h - 1);
 
-    buf[sy * stride + sx] += color;
+    if (sy >= y0 && sy < y1)
+        buf[sy * stride + sx] += color;
 
     if (FFABS(ex - sx) > FFABS(ey - sy)) {
         if (sx > ex) {
@@ -140,12 +160,16 @@ static void draw_line(uint8_t *buf, int sx, int sy, int ex, int ey,
         }
         buf += sx + sy * stride;
         ex  -= sx;
+        y0  -= sy;
+        y1  -= sy;
         f    = ((ey - sy) << 16) / ex;
         for (x = 0; x <= ex; x++) {
             y  = (x * f) >> 16;
             fr = (x * f) & 0xFFFF;
-                   buf[ y      * stride + x] += (color * (0x10000 - fr)) >> 16;
-            if(fr) buf[(y + 1) * stride + x] += (color *            fr ) >> 16;
+            if (y >= y0 && y < y1)
+                buf[ y      * stride + x] += (color * (0x10000 - fr)) >> 16;
+            if (fr && y + 1 >= y0 && y + 1 < y1)
+                buf[(y + 1) * stride + x] += (color *            fr ) >> 16;
         }
     } else {
         if (sy > ey) {
@@ -154,11 +178,13 @@ static void draw_line(uint8_t *buf, int sx, int sy, int ex, int ey,
         }
         buf += sx + sy * stride;
         ey  -= sy;
+        y0  -= sy;
+        y1  -= sy;
         if (ey)
             f = ((ex - sx) << 16) / ey;
         else
             f = 0;
-        for(y= 0; y <= ey; y++){
+        for (y = FFMAX(y0, 0); y <= FFMIN(ey, y1 - 1); y++) {
             x  = (y*f) >> 16;
             fr = (y*f) & 0xFFFF;
                    buf[y * stride + x    ] += (color * (0x10000 - fr)) >> 16;
@@ -168,14 +194,16 @@ static void draw_line(uint8_t *buf, int sx, int sy, int ex, int ey,
 }
 
 /**
- * Draw an arrow from (ex, ey) -> (sx, sy).
+ * Draw an arrow from (ex, ey) -> (sx, sy), only touching the rows from y0
+ * to y1 - 1.
  * @param w width of the image
  * @param h height of the image
  * @param stride stride/linesize of the image
  * @param color color of the arrow
  */
 static void draw_arrow(uint8_t *buf, int sx, int sy, int ex,
-                       int ey, int w, int h, int stride, int color, int tail, int direction)
+                       int ey, int w, int h, int stride, int color, int tail, int direction,
+                       int y0, int y1)
 {
     int dx,dy;
 
@@ -192,6 +220,13 @@ static void draw_arrow(uint8_t *buf, int sx, int sy, int ex,
     dx = ex - sx;
     dy = ey - sy;
 
+    if (!dx && !dy) {
+        /* a zero vector is a dot, drawn twice by draw_line() */
+        if (sx >= 0 && sx < w && sy >= y0 && sy < y1 && sy < h)
+            buf[sy * stride + sx] += 2 * color;
+        return;
+    }
+
     if (dx * dx + dy * dy > 3 * 3) {
         int rx =  dx + dy;
         int ry = -dx + dy;
@@ -206,10 +241,104 @@ static void draw_arrow(uint8_t *buf, int sx, int sy, int ex,
             ry = -ry;
         }
 
-        draw_line(buf, sx, sy, sx + rx, sy + ry, w, h, stride, color);
-        draw_line(buf, sx, sy, sx - ry, sy + rx, w, h, stride, color);
+        draw_line(buf, sx, sy, sx + rx, sy + ry, w, h, stride, color, y0, y1);
+        draw_line(buf, sx, sy, sx - ry, sy + rx, w, h, stride, color, y0, y1);
+    }
+    draw_line(buf, sx, sy, ex, ey, w, h, stride, color, y0, y1);
+}
+
+static int draw_qp_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    CodecViewContext *s = ctx->priv;
+    AVFrame *frame = arg;
+    int qstride, qp_type, x, y;
+    int8_t *qp_table = av_frame_get_qp_table(frame, &qstride, &qp_type);
+    const int w = AV_CEIL_RSHIFT(frame->width,  s->hsub);
+    const int h = AV_CEIL_RSHIFT(frame->height, s->vsub);
+    const int slice_start = (h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    uint8_t *pu = frame->data[1] + slice_start * frame->linesize[1];
+    uint8_t *pv = frame->data[2] + slice_start * frame->linesize[2];
+
+    for (y = slice_start; y < slice_end; y++) {
+        /* each qp entry covers a span of 8 chroma samples */
+        for (x = 0; x < w; x += 8) {
+            const int qp = ff_norm_qscale(qp_table[(y >> 3) * qstride + (x >> 3)], qp_type) * 128/31;
+            memset(pu + x, qp, FFMIN(8, w - x));
+            memset(pv + x, qp, FFMIN(8, w - x));
+        }
+        pu += frame->linesize[1];
+        pv += frame->linesize[2];
+    }
+    return 0;
+}
+
+static int draw_mvs_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    CodecViewContext *s = ctx->priv;
+    AVFrame *frame = arg;
+    const int y0 = jobnr * s->band_h;
+    const int y1 = FFMIN(y0 + s->band_h, frame->height);
+    int i;
+
+    for (i = s->bin_start[jobnr]; i < s->bin_start[jobnr + 1]; i++) {
+        const AVMotionVector *mv = &s->mvs[s->bin_idx[i]];
+        draw_arrow(frame->data[0], mv->dst_x, mv->dst_y, mv->src_x, mv->src_y,
+                   frame->width, frame->height, frame->linesize[0],
+                   100, 0, mv->source > 0, y0, y1);
     }
-    draw_line(buf, sx, sy, ex, ey, w, h, stride, color);
+    return 0;
+}
+
+/* rows covered by the arrow of a vector, clipped to the frame */
+static void arrow_rows(const AVMotionVector *mv, int h, int *ymin, int *ymax)
+{
+    int sy = av_clip(mv->dst_y, -100, h + 100);
+    int ey = av_clip(mv->src_y, -100, h + 100);
+
+    *ymin = FFMAX(FFMIN(sy, ey) - ARROW_MARGIN, 0);
+    *ymax = FFMIN(FFMAX(sy, ey) + ARROW_MARGIN, h - 1);
+}
+
+/**
+ * Bin the vectors selected by draw[direction] per band.
+ * @return the total number of bin entries, or a negative error code
+ */
+static int bin_mvs(CodecViewContext *s, const AVMotionVector *mvs, int nb_mvs,
+                   const int draw[2], int h)
+{
+    int count[MAX_BANDS] = { 0 };
+    int i, n, ymin, ymax;
+
+    for (i = 0; i < nb_mvs; i++) {
+        if (!draw[mvs[i].source > 0])
+            continue;
+        arrow_rows(&mvs[i], h, &ymin, &ymax);
+        for (n = ymin / s->band_h; n <= ymax / s->band_h && n < s->nb_bands; n++)
+            count[n]++;
+    }
+
+    s->bin_start[0] = 0;
+    for (n = 0; n < s->nb_bands; n++)
+        s->bin_start[n + 1] = s->bin_start[n] + count[n];
+    if (!s->bin_start[s->nb_bands])
+        return 0;
+
+    av_fast_malloc(&s->bin_idx, &s->bin_idx_size,
+                   s->bin_start[s->nb_bands] * sizeof(*s->bin_idx));
+    if (!s->bin_idx)
+        return AVERROR(ENOMEM);
+
+    memcpy(count, s->bin_start, s->nb_bands * sizeof(*count));
+    for (i = 0; i < nb_mvs; i++) {
+        if (!draw[mvs[i].source > 0])
+            continue;
+        arrow_rows(&mvs[i], h, &ymin, &ymax);
+        for (n = ymin / s->band_h; n <= ymax / s->band_h && n < s->nb_bands; n++)
+            s->bin_idx[count[n]++] = i;
+    }
+
+    return s->bin_start[s->nb_bands];
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
@@ -220,59 +349,54 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 
     if (s->qp) {
         int qstride, qp_type;
-        int8_t *qp_table = av_frame_get_qp_table(frame, &qstride, &qp_type);
-
-        if (qp_table) {
-            int x, y;
-            const int w = AV_CEIL_RSHIFT(frame->width,  s->hsub);
-            const int h = AV_CEIL_RSHIFT(frame->height, s->vsub);
-            uint8_t *pu = frame->data[1];
-            uint8_t *pv = frame->data[2];
-            const int lzu = frame->linesize[1];
-            const int lzv = frame->linesize[2];
-
-            for (y = 0; y < h; y++) {
-                for (x = 0; x < w; x++) {
-                    const int qp = ff_norm_qscale(qp_table[(y >> 3) * qstride + (x >> 3)], qp_type) * 128/31;
-                    pu[x] = pv[x] = qp;
-                }
-                pu += lzu;
-                pv += lzv;
-            }
-        }
+
+        if (av_frame_get_qp_table(frame, &qstride, &qp_type))
+            ctx->internal->execute(ctx, draw_qp_slice, frame, NULL,
+                                   FFMIN(AV_CEIL_RSHIFT(frame->height, s->vsub),
+                                         ff_filter_get_nb_threads(ctx)));
     }
 
     if (s->mv || s->mv_type) {
         AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
         if (sd) {
-            int i;
-            const AVMotionVector *mvs = (const AVMotionVector *)sd->data;
+            int draw[2], direction, ret;
             const int is_iframe = (s->frame_type & FRAME_TYPE_I) && frame->pict_type == AV_PICTURE_TYPE_I;
             const int is_pframe = (s->frame_type & FRAME_TYPE_P) && frame->pict_type == AV_PICTURE_TYPE_P;
             const int is_bframe = (s->frame_type & FRAME_TYPE_B) && frame->pict_type == AV_PICTURE_TYPE_B;
 
-            for (i = 0; i < sd->size / sizeof(*mvs); i++) {
-                const AVMotionVector *mv = &mvs[i];
-                const int direction = mv->source > 0;
-
+            /* the selection only depends on the direction, so decide it once
+             * per frame instead of per vector */
+            for (direction = 0; direction < 2; direction++) {
                 if (s->mv_type) {
                     const int is_fp = direction == 0 && (s->mv_type & MV_TYPE_FOR);
                     const int is_bp = direction == 1 && (s->mv_type & MV_TYPE_BACK);
 
-                    if ((!s->frame_type && (is_fp || is_bp)) ||
-                        is_iframe && is_fp || is_iframe && is_bp ||
-                        is_pframe && is_fp ||
-                        is_bframe && is_fp || is_bframe && is_bp)
-                        draw_arrow(frame->data[0], mv->dst_x, mv->dst_y, mv->src_x, mv->src_y,
-                                   frame->width, frame->height, frame->linesize[0],
-                                   100, 0, direction);
-                } else if (s->mv)
-                    if ((direction == 0 && (s->mv & MV_P_FOR)  && frame->pict_type == AV_PICTURE_TYPE_P) ||
-                        (direction == 0 && (s->mv & MV_B_FOR)  && frame->pict_type == AV_PICTURE_TYPE_B) ||
-                        (direction == 1 && (s->mv & MV_B_BACK) && frame->pict_type == AV_PICTURE_TYPE_B))
-                        draw_arrow(frame->data[0], mv->dst_x, mv->dst_y, mv->src_x, mv->src_y,
-                                   frame->width, frame->height, frame->linesize[0],
-                                   100, 0, direction);
+                    draw[direction] = (!s->frame_type && (is_fp || is_bp)) ||
+                                      is_iframe && is_fp || is_iframe && is_bp ||
+                                      is_pframe && is_fp ||
+                                      is_bframe && is_fp || is_bframe && is_bp;
+                } else {
+                    draw[direction] = (direction == 0 && (s->mv & MV_P_FOR)  && frame->pict_type == AV_PICTURE_TYPE_P) ||
+                                      (direction == 0 && (s->mv & MV_B_FOR)  && frame->pict_type == AV_PICTURE_TYPE_B) ||
+                                      (direction == 1 && (s->mv & MV_B_BACK) && frame->pict_type == AV_PICTURE_TYPE_B);
+                }
+            }
+
+            s->nb_bands = FFMIN(ff_filter_get_nb_threads(ctx), MAX_BANDS);
+            s->band_h   = (frame->height + s->nb_bands - 1) / s->nb_bands;
+            s->nb_bands = (frame->height + s->band_h   - 1) / s->band_h;
+
+            if (draw[0] || draw[1]) {
+                ret = bin_mvs(s, (const AVMotionVector *)sd->data,
+                              sd->size / sizeof(AVMotionVector), draw, frame->height);
+                if (ret < 0) {
+                    av_frame_free(&frame);
+                    return ret;
+                }
+                if (ret > 0) {
+                    s->mvs = (const AVMotionVector *)sd->data;
+                    ctx->internal->execute(ctx, draw_mvs_slice, frame, NULL, s->nb_bands);
+                }
             }
         }
     }
@@ -280,6 +404,14 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     return ff_filter_frame(outlink, frame);
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    CodecViewContext *s = ctx->priv;
+
+    av_freep(&s->bin_idx);
+    s->bin_idx_size = 0;
+}
+
 static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -315,8 +447,9 @@ AVFilter ff_vf_codecview = {
     .description   = NULL_IF_CONFIG_SMALL("Visualize information about some codecs."),
     .priv_size     = sizeof(CodecViewContext),
     .query_formats = query_formats,
+    .uninit        = uninit,
     .inputs        = codecview_inputs,
     .outputs       = codecview_outputs,
     .priv_class    = &codecview_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -35,6 +35,8 @@ typedef struct MEContext {
     const AVClass *class;
     AVMotionEstContext me_ctx;
     int method;                         ///< motion estimation method
+    int mv_source;                      ///< use of the decoder motion vectors
+    int poc_step;                       ///< POC units per frame of the decoder vectors, 0 if unused
 
     int mb_size;                        ///< macroblock size
     int search_param;                   ///< search parameter
@@ -44,6 +46,8 @@ typedef struct MEContext {
     AVFrame *prev, *cur, *next;
 
     int (*mv_table[3])[2][2];           ///< motion vectors of current & prev 2 frames
+    AVMotionEstDecoderMV *dec_mvs;      ///< decoder motion vectors of the current frame
+    int warned_no_mvs;
 } MEContext;
 
 #define OFFSET(x) offsetof(MEContext, x)
@@ -63,6 +67,11 @@ static const AVOption mestimate_options[] = {
         CONST("umh",   "uneven multi-hexagon search",        AV_ME_METHOD_UMH,      "method"),
     { "mb_size", "macroblock size", OFFSET(mb_size), AV_OPT_TYPE_INT, {.i64 = 16}, 8, INT_MAX, FLAGS },
     { "search_param", "search parameter", OFFSET(search_param), AV_OPT_TYPE_INT, {.i64 = 7}, 4, INT_MAX, FLAGS },
+    { "mv_source", "source of the motion vectors", OFFSET(mv_source), AV_OPT_TYPE_INT, {.i64 = AV_ME_SOURCE_ESTIMATE}, AV_ME_SOURCE_ESTIMATE, AV_ME_SOURCE_HYBRID, FLAGS, "mv_source" },
+        CONST("estimate", "search the motion vectors",                      AV_ME_SOURCE_ESTIMATE, "mv_source"),
+        CONST("decoder",  "refine the motion vectors exported by the decoder", AV_ME_SOURCE_DECODER,  "mv_source"),
+        CONST("hybrid",   "search, trying the decoder motion vectors too",  AV_ME_SOURCE_HYBRID,   "mv_source"),
+    { "poc_step", "POC units per frame of the decoder motion vectors", OFFSET(poc_step), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, FLAGS },
     { NULL }
 };
 
@@ -106,6 +115,12 @@ static int config_input(AVFilterLink *inlink)
             return AVERROR(ENOMEM);
     }
 
+    if (s->mv_source != AV_ME_SOURCE_ESTIMATE) {
+        s->dec_mvs = av_malloc_array(s->b_count, sizeof(*s->dec_mvs));
+        if (!s->dec_mvs)
+            return AVERROR(ENOMEM);
+    }
+
     ff_me_init_context(&s->me_ctx, s->mb_size, s->search_param, inlink->w, inlink->h, 0, (s->b_width - 1) << s->log2_mb_size, 0, (s->b_height - 1) << s->log2_mb_size);
 
     return 0;
@@ -120,10 +135,60 @@ static void add_mv_data(AVMotionVector *mv, int mb_size,
     mv->dst_y = y + (mb_size >> 1);
     mv->src_x = x_mv + (mb_size >> 1);
     mv->src_y = y_mv + (mb_size >> 1);
+    mv->motion_x = x_mv - x;
+    mv->motion_y = y_mv - y;
+    mv->motion_scale = 1;
     mv->source = dir ? 1 : -1;
     mv->flags = 0;
 }
 
+/**
+ * Get the decoder motion vector of a block to the given direction. If the
+ * decoder only exported a vector to the other direction, motion is assumed
+ * to be linear.
+ *
+ * @return 0 if the decoder did not export any vector for the block
+ */
+static int get_decoder_mv(MEContext *s, int mb_i, int dir, int *cand)
+{
+    const AVMotionEstDecoderMV *dec = &s->dec_mvs[mb_i];
+
+    if (dec->nb[dir]) {
+        cand[0] = dec->mvs[dir][0];
+        cand[1] = dec->mvs[dir][1];
+    } else if (dec->nb[!dir]) {
+        cand[0] = -dec->mvs[!dir][0];
+        cand[1] = -dec->mvs[!dir][1];
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Refine the decoder motion vector of a block and use it instead of mv if
+ * it costs less than cost.
+ */
+static void search_decoder_mv(MEContext *s, int mb_x, int mb_y, int dir, int *mv, uint64_t cost)
+{
+    const int x_mb = mb_x << s->log2_mb_size;
+    const int y_mb = mb_y << s->log2_mb_size;
+    int mv_dec[2] = {x_mb, y_mb};
+    int cand[2];
+
+    if (!get_decoder_mv(s, mb_x + mb_y * s->b_width, dir, cand))
+        return;
+
+    s->me_ctx.pred_x = cand[0];
+    s->me_ctx.pred_y = cand[1];
+
+    if (ff_me_search_refine(&s->me_ctx, x_mb, y_mb, cand[0], cand[1], mv_dec) < cost) {
+        mv[0] = mv_dec[0];
+        mv[1] = mv_dec[1];
+    }
+}
+
 #define SEARCH_MV(method)\
     do {\
         for (mb_y = 0; mb_y < s->b_height; mb_y++)\
@@ -131,7 +196,9 @@ static void add_mv_data(AVMotionVector *mv, int mb_size,
                 const int x_mb = mb_x << s->log2_mb_size;\
                 const int y_mb = mb_y << s->log2_mb_size;\
                 int mv[2] = {x_mb, y_mb};\
-                ff_me_search_##method(me_ctx, x_mb, y_mb, mv);\
+                uint64_t cost = ff_me_search_##method(me_ctx, x_mb, y_mb, mv);\
+                if (s->mv_source == AV_ME_SOURCE_HYBRID)\
+                    search_decoder_mv(s, mb_x, mb_y, dir, mv, cost);\
                 add_mv_data(((AVMotionVector *) sd->data) + mv_count++, me_ctx->mb_size, x_mb, y_mb, mv[0], mv[1], dir);\
             }\
     } while (0)
@@ -151,6 +218,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     AVFrameSideData *sd;
     AVFrame *out;
     int mb_x, mb_y, dir;
+    int cand[2];
     int32_t mv_count = 0;
     int ret;
 
@@ -180,6 +248,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     if (!out)
         return AVERROR(ENOMEM);
 
+    if (s->mv_source != AV_ME_SOURCE_ESTIMATE &&
+        !ff_me_get_decoder_mvs(s->cur, s->dec_mvs, s->b_width, s->b_height, s->log2_mb_size, s->poc_step) &&
+        s->cur->pict_type != AV_PICTURE_TYPE_I)
+        ff_me_warn_no_decoder_mvs(ctx, &s->warned_no_mvs, s->poc_step > 0);
+
+    /* replace the decoder motion vectors */
+    av_frame_remove_side_data(out, AV_FRAME_DATA_MOTION_VECTORS);
     sd = av_frame_new_side_data(out, AV_FRAME_DATA_MOTION_VECTORS, 2 * s->b_count * sizeof(AVMotionVector));
     if (!sd) {
         av_frame_free(&out);
@@ -192,7 +267,36 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     for (dir = 0; dir < 2; dir++) {
         me_ctx->data_ref = (dir ? s->next : s->prev)->data[0];
 
-        if (s->method == AV_ME_METHOD_DS)
+        if (s->mv_source == AV_ME_SOURCE_DECODER) {
+            for (mb_y = 0; mb_y < s->b_height; mb_y++)
+                for (mb_x = 0; mb_x < s->b_width; mb_x++) {
+                    const int mb_i = mb_x + mb_y * s->b_width;
+                    const int x_mb = mb_x << s->log2_mb_size;
+                    const int y_mb = mb_y << s->log2_mb_size;
+                    int mv[2] = {x_mb, y_mb};
+
+                    //intra blocks start from the left or top mb
+                    if (!get_decoder_mv(s, mb_i, dir, cand)) {
+                        if (mb_x > 0) {
+                            cand[0] = s->mv_table[0][mb_i - 1][dir][0];
+                            cand[1] = s->mv_table[0][mb_i - 1][dir][1];
+                        } else if (mb_y > 0) {
+                            cand[0] = s->mv_table[0][mb_i - s->b_width][dir][0];
+                            cand[1] = s->mv_table[0][mb_i - s->b_width][dir][1];
+                        } else {
+                            cand[0] = cand[1] = 0;
+                        }
+                    }
+
+                    me_ctx->pred_x = cand[0];
+                    me_ctx->pred_y = cand[1];
+                    ff_me_search_refine(me_ctx, x_mb, y_mb, cand[0], cand[1], mv);
+
+                    s->mv_table[0][mb_i][dir][0] = mv[0] - x_mb;
+                    s->mv_table[0][mb_i][dir][1] = mv[1] - y_mb;
+                    add_mv_data(((AVMotionVector *) sd->data) + mv_count++, me_ctx->mb_size, x_mb, y_mb, mv[0], mv[1], dir);
+                }
+        } else if (s->method == AV_ME_METHOD_DS)
             SEARCH_MV(ds);
         else if (s->method == AV_ME_METHOD_ESA)
             SEARCH_MV(esa);
@@ -250,6 +354,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
                         me_ctx->pred_y = 0;
                     }
 
+                    //decoder mv
+                    if (s->mv_source == AV_ME_SOURCE_HYBRID && get_decoder_mv(s, mb_i, dir, cand))
+                        ADD_PRED(preds[0], cand[0], cand[1]);
+
                     ff_me_search_umh(me_ctx, x_mb, y_mb, mv);
 
                     s->mv_table[0][mb_i][dir][0] = mv[0] - x_mb;
@@ -322,6 +430,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
                     if (mb_y + 1 < s->b_height)
                         ADD_PRED(preds[1], s->mv_table[1][mb_i + s->b_width][dir][0], s->mv_table[1][mb_i + s->b_width][dir][1]);
 
+                    //decoder mv
+                    if (s->mv_source == AV_ME_SOURCE_HYBRID && get_decoder_mv(s, mb_i, dir, cand))
+                        ADD_PRED(preds[1], cand[0], cand[1]);
+
                     ff_me_search_epzs(me_ctx, x_mb, y_mb, mv);
 
                     s->mv_table[0][mb_i][dir][0] = mv[0] - x_mb;
@@ -331,6 +443,8 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
         }
     }
 
+    emms_c();
+
     return ff_filter_frame(ctx->outputs[0], out);
 }
 
@@ -345,6 +459,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < 3; i++)
         av_freep(&s->mv_table[i]);
+    av_freep(&s->dec_mvs);
 }
 
 static const AVFilterPad mestimate_inputs[] = {
@@ -171,6 +171,8 @@ typedef struct MIContext {
     int mc_mode;
     int me_mode;
     int me_method;
+    int mv_source;
+    int poc_step;
     int mb_size;
     int search_param;
     int vsbmc;
@@ -182,6 +184,8 @@ typedef struct MIContext {
     PixelWeights *pixel_weights;
     PixelRefs *pixel_refs;
     int (*mv_table[3])[2][2];
+    AVMotionEstDecoderMV *dec_mvs[2];
+    int warned_no_mvs;
     int64_t out_pts;
     int b_width, b_height, b_count;
     int log2_mb_size;
@@ -224,6 +228,11 @@ static const AVOption minterpolate_options[] = {
         CONST("hexbs",  "hexagon-based search",                 AV_ME_METHOD_HEXBS,     "me"),
         CONST("epzs",   "enhanced predictive zonal search",     AV_ME_METHOD_EPZS,      "me"),
         CONST("umh",    "uneven multi-hexagon search",          AV_ME_METHOD_UMH,       "me"),
+    { "mv_source", "source of the motion vectors", OFFSET(mv_source), AV_OPT_TYPE_INT, {.i64 = AV_ME_SOURCE_ESTIMATE}, AV_ME_SOURCE_ESTIMATE, AV_ME_SOURCE_HYBRID, FLAGS, "mv_source" },
+        CONST("estimate", "search the motion vectors",           AV_ME_SOURCE_ESTIMATE,  "mv_source"),
+        CONST("decoder",  "refine the motion vectors exported by the decoder", AV_ME_SOURCE_DECODER, "mv_source"),
+        CONST("hybrid",   "search, trying the decoder motion vectors too", AV_ME_SOURCE_HYBRID, "mv_source"),
+    { "poc_step", "POC units per frame of the decoder motion vectors", OFFSET(poc_step), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, FLAGS },
     { "mb_size", "macroblock size", OFFSET(mb_size), AV_OPT_TYPE_INT, {.i64 = 16}, 4, 16, FLAGS },
     { "search_param", "search parameter", OFFSET(search_param), AV_OPT_TYPE_INT, {.i64 = 32}, 4, INT_MAX, FLAGS },
     { "vsbmc", "variable-size block motion compensation", OFFSET(vsbmc), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, FLAGS },
@@ -261,6 +270,7 @@ static uint64_t get_sbad(AVMotionEstContext *me_ctx, int x, int y, int x_mv, int
     uint8_t *data_cur = me_ctx->data_cur;
     uint8_t *data_next = me_ctx->data_ref;
     int linesize = me_ctx->linesize;
+    av_pixelutils_sad_fn sad_fn = ff_me_get_sad_fn(me_ctx, me_ctx->mb_size);
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
     int mv_x, mv_y, i, j;
@@ -274,9 +284,13 @@ static uint64_t get_sbad(AVMotionEstContext *me_ctx, int x, int y, int x_mv, int
     data_cur += (y + mv_y) * linesize;
     data_next += (y - mv_y) * linesize;
 
-    for (j = 0; j < me_ctx->mb_size; j++)
-        for (i = 0; i < me_ctx->mb_size; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + j * linesize] - data_next[x - mv_x + i + j * linesize]);
+    if (sad_fn) {
+        sbad = sad_fn(data_cur + x + mv_x, linesize, data_next + x - mv_x, linesize);
+    } else {
+        for (j = 0; j < me_ctx->mb_size; j++)
+            for (i = 0; i < me_ctx->mb_size; i++)
+                sbad += FFABS(data_cur[x + mv_x + i + j * linesize] - data_next[x - mv_x + i + j * linesize]);
+    }
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -290,6 +304,7 @@ static uint64_t get_sbad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv,
     int x_max = me_ctx->x_max - me_ctx->mb_size / 2;
     int y_min = me_ctx->y_min + me_ctx->mb_size / 2;
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
+    av_pixelutils_sad_fn sad_ob = ff_me_get_sad_fn(me_ctx, 2 * me_ctx->mb_size);
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
     int mv_x, mv_y, i, j;
@@ -300,9 +315,14 @@ static uint64_t get_sbad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv,
     mv_x = av_clip(x_mv - x, -FFMIN(x - x_min, x_max - x), FFMIN(x - x_min, x_max - x));
     mv_y = av_clip(y_mv - y, -FFMIN(y - y_min, y_max - y), FFMIN(y - y_min, y_max - y));
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + (y + mv_y + j) * linesize] - data_next[x - mv_x + i + (y - mv_y + j) * linesize]);
+    if (sad_ob) {
+        sbad = sad_ob(data_cur  + x + mv_x - me_ctx->mb_size / 2 + (y + mv_y - me_ctx->mb_size / 2) * linesize, linesize,
+                      data_next + x - mv_x - me_ctx->mb_size / 2 + (y - mv_y - me_ctx->mb_size / 2) * linesize, linesize);
+    } else {
+        for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
+            for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
+                sbad += FFABS(data_cur[x + mv_x + i + (y + mv_y + j) * linesize] - data_next[x - mv_x + i + (y - mv_y + j) * linesize]);
+    }
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -316,6 +336,7 @@ static uint64_t get_sad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv, i
     int x_max = me_ctx->x_max - me_ctx->mb_size / 2;
     int y_min = me_ctx->y_min + me_ctx->mb_size / 2;
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
+    av_pixelutils_sad_fn sad_ob = ff_me_get_sad_fn(me_ctx, 2 * me_ctx->mb_size);
     int mv_x = x_mv - x;
     int mv_y = y_mv - y;
     int i, j;
@@ -326,9 +347,14 @@ static uint64_t get_sad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv, i
     x_mv = av_clip(x_mv, x_min, x_max);
     y_mv = av_clip(y_mv, y_min, y_max);
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sad += FFABS(data_ref[x_mv + i + (y_mv + j) * linesize] - data_cur[x + i + (y + j) * linesize]);
+    if (sad_ob) {
+        sad = sad_ob(data_ref + x_mv - me_ctx->mb_size / 2 + (y_mv - me_ctx->mb_size / 2) * linesize, linesize,
+                     data_cur + x    - me_ctx->mb_size / 2 + (y    - me_ctx->mb_size / 2) * linesize, linesize);
+    } else {
+        for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
+            for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
+                sad += FFABS(data_ref[x_mv + i + (y_mv + j) * linesize] - data_cur[x + i + (y + j) * linesize]);
+    }
 
     return sad + (FFABS(mv_x - me_ctx->pred_x) + FFABS(mv_y - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -382,6 +408,14 @@ static int config_input(AVFilterLink *inlink)
                     return AVERROR(ENOMEM);
             }
         }
+
+        if (mi_ctx->mv_source != AV_ME_SOURCE_ESTIMATE) {
+            for (i = 0; i < 2; i++) {
+                mi_ctx->dec_mvs[i] = av_malloc_array(mi_ctx->b_count, sizeof(*mi_ctx->dec_mvs[0]));
+                if (!mi_ctx->dec_mvs[i])
+                    return AVERROR(ENOMEM);
+            }
+        }
     }
 
     if (mi_ctx->scd_method == SCD_METHOD_FDIFF) {
@@ -424,6 +458,45 @@ static int config_output(AVFilterLink *outlink)
         preds.nb++;\
     } while(0)
 
+/**
+ * Get the decoder motion vector of a block, as searched by search_mv().
+ * For bidirectional estimation, these are the vectors of frames[2]; if the
+ * decoder only exported a vector to the other direction, motion is assumed
+ * to be linear. For bilateral estimation, the vector to frames[1] of
+ * frames[2] or the one to frames[2] of frames[1] is halved.
+ *
+ * @return 0 if the decoder did not export any vector for the block
+ */
+static int get_decoder_mv(MIContext *mi_ctx, int mb_i, int dir, int *cand)
+{
+    const AVMotionEstDecoderMV *dec = &mi_ctx->dec_mvs[1][mb_i];
+    const AVMotionEstDecoderMV *dec_prev = &mi_ctx->dec_mvs[0][mb_i];
+
+    if (mi_ctx->me_mode == ME_MODE_BIDIR) {
+        if (dec->nb[dir]) {
+            cand[0] = dec->mvs[dir][0];
+            cand[1] = dec->mvs[dir][1];
+        } else if (dec->nb[!dir]) {
+            cand[0] = -dec->mvs[!dir][0];
+            cand[1] = -dec->mvs[!dir][1];
+        } else {
+            return 0;
+        }
+    } else {
+        if (dec->nb[0]) {
+            cand[0] = ROUNDED_DIV(dec->mvs[0][0], 2);
+            cand[1] = ROUNDED_DIV(dec->mvs[0][1], 2);
+        } else if (dec_prev->nb[1]) {
+            cand[0] = -ROUNDED_DIV(dec_prev->mvs[1][0], 2);
+            cand[1] = -ROUNDED_DIV(dec_prev->mvs[1][1], 2);
+        } else {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int dir)
 {
     AVMotionEstContext *me_ctx = &mi_ctx->me_ctx;
@@ -434,28 +507,54 @@ static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int
     const int y_mb = mb_y << mi_ctx->log2_mb_size;
     const int mb_i = mb_x + mb_y * mi_ctx->b_width;
     int mv[2] = {x_mb, y_mb};
+    int mv_dec[2] = {x_mb, y_mb};
+    int cand[2];
+    uint64_t cost = UINT64_MAX;
+
+    if (mi_ctx->mv_source == AV_ME_SOURCE_DECODER) {
+        //intra blocks start from the left or top mb
+        if (!get_decoder_mv(mi_ctx, mb_i, dir, cand)) {
+            if (mb_x > 0) {
+                cand[0] = blocks[mb_i - 1].mvs[dir][0];
+                cand[1] = blocks[mb_i - 1].mvs[dir][1];
+            } else if (mb_y > 0) {
+                cand[0] = blocks[mb_i - mi_ctx->b_width].mvs[dir][0];
+                cand[1] = blocks[mb_i - mi_ctx->b_width].mvs[dir][1];
+            } else {
+                cand[0] = cand[1] = 0;
+            }
+        }
+
+        me_ctx->pred_x = cand[0];
+        me_ctx->pred_y = cand[1];
+        ff_me_search_refine(me_ctx, x_mb, y_mb, cand[0], cand[1], mv);
+
+        block->mvs[dir][0] = mv[0] - x_mb;
+        block->mvs[dir][1] = mv[1] - y_mb;
+        return;
+    }
 
     switch (mi_ctx->me_method) {
         case AV_ME_METHOD_ESA:
-            ff_me_search_esa(me_ctx, x_mb, y_mb, mv);
+            cost = ff_me_search_esa(me_ctx, x_mb, y_mb, mv);
             break;
         case AV_ME_METHOD_TSS:
-            ff_me_search_tss(me_ctx, x_mb, y_mb, mv);
+            cost = ff_me_search_tss(me_ctx, x_mb, y_mb, mv);
             break;
         case AV_ME_METHOD_TDLS:
-            ff_me_search_tdls(me_ctx, x_mb, y_mb, mv);
+            cost = ff_me_search_tdls(me_ctx, x_mb, y_mb, mv);
             break;
         case AV_ME_METHOD_NTSS:
-            ff_me_search_ntss(me_ctx, x_mb, y_mb, mv);
+            cost = ff_me_search_ntss(me_ctx, x_mb, y_mb, mv);
             break;
         case AV_ME_METHOD_FSS:
-            ff_me_search_fss(me_ctx, x_mb, y_mb, mv);
+            cost = ff_me_search_fss(me_ctx, x_mb, y_mb, mv);
             break;
         case AV_ME_METHOD_DS:
-            ff_me_search_ds(me_ctx, x_mb, y_mb, mv);
+            cost = ff_me_search_ds(me_ctx, x_mb, y_mb, mv);
             break;
         case AV_ME_METHOD_HEXBS:
-            ff_me_search_hexbs(me_ctx, x_mb, y_mb, mv);
+            cost = ff_me_search_hexbs(me_ctx, x_mb, y_mb, mv);
             break;
         case AV_ME_METHOD_EPZS:
 
@@ -514,6 +613,10 @@ static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int
             if (mb_y + 1 < mi_ctx->b_height)
                 ADD_PRED(preds[1], mi_ctx->mv_table[1][mb_i + mi_ctx->b_width][dir][0], mi_ctx->mv_table[1][mb_i + mi_ctx->b_width][dir][1]);
 
+            //decoder mv
+            if (mi_ctx->mv_source == AV_ME_SOURCE_HYBRID && get_decoder_mv(mi_ctx, mb_i, dir, cand))
+                ADD_PRED(preds[1], cand[0], cand[1]);
+
             ff_me_search_epzs(me_ctx, x_mb, y_mb, mv);
 
             mi_ctx->mv_table[0][mb_i][dir][0] = mv[0] - x_mb;
@@ -557,11 +660,24 @@ static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int
                 me_ctx->pred_y = 0;
             }
 
+            //decoder mv
+            if (mi_ctx->mv_source == AV_ME_SOURCE_HYBRID && get_decoder_mv(mi_ctx, mb_i, dir, cand))
+                ADD_PRED(preds[0], cand[0], cand[1]);
+
             ff_me_search_umh(me_ctx, x_mb, y_mb, mv);
 
             break;
     }
 
+    //keep the refined decoder mv if it is better than the searched one
+    if (mi_ctx->mv_source == AV_ME_SOURCE_HYBRID &&
+        mi_ctx->me_method != AV_ME_METHOD_EPZS && mi_ctx->me_method != AV_ME_METHOD_UMH &&
+        get_decoder_mv(mi_ctx, mb_i, dir, cand) &&
+        ff_me_search_refine(me_ctx, x_mb, y_mb, cand[0], cand[1], mv_dec) < cost) {
+        mv[0] = mv_dec[0];
+        mv[1] = mv_dec[1];
+    }
+
     block->mvs[dir][0] = mv[0] - x_mb;
     block->mvs[dir][1] = mv[1] - y_mb;
 }
@@ -587,6 +703,12 @@ static void bilateral_me(MIContext *mi_ctx)
             search_mv(mi_ctx, mi_ctx->int_blocks, mb_x, mb_y, 0);
 }
 
+/**
+ * Split a block into sub-blocks where this lowers the cost, refining the
+ * vector of the block for each of them. The decoder vectors are not tried
+ * here: they are averaged on the block grid, so a sub-block would only get
+ * the decoder vector its block was already seeded with.
+ */
 static int var_size_bme(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n)
 {
     AVMotionEstContext *me_ctx = &mi_ctx->me_ctx;
@@ -739,6 +861,21 @@ static int cluster_mvs(MIContext *mi_ctx)
     return 0;
 }
 
+static void get_decoder_mvs(AVFilterContext *ctx)
+{
+    MIContext *mi_ctx = ctx->priv;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        AVFrame *avf = mi_ctx->frames[i + 1].avf;
+
+        if (!ff_me_get_decoder_mvs(avf, mi_ctx->dec_mvs[i], mi_ctx->b_width, mi_ctx->b_height,
+                                   mi_ctx->log2_mb_size, mi_ctx->poc_step) &&
+            avf->pict_type != AV_PICTURE_TYPE_I)
+            ff_me_warn_no_decoder_mvs(ctx, &mi_ctx->warned_no_mvs, mi_ctx->poc_step > 0);
+    }
+}
+
 static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -762,6 +899,9 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
         if (mi_ctx->me_mode == ME_MODE_BIDIR) {
 
             if (mi_ctx->frames[1].avf) {
+                if (mi_ctx->mv_source != AV_ME_SOURCE_ESTIMATE)
+                    get_decoder_mvs(ctx);
+
                 for (dir = 0; dir < 2; dir++) {
                     mi_ctx->me_ctx.linesize = mi_ctx->frames[2].avf->linesize[0];
                     mi_ctx->me_ctx.data_cur = mi_ctx->frames[2].avf->data[0];
@@ -771,6 +911,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
                         for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
                             search_mv(mi_ctx, mi_ctx->frames[2].blocks, mb_x, mb_y, dir);
                 }
+                emms_c();
             }
 
         } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
@@ -780,6 +921,9 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
             if (!mi_ctx->frames[0].avf)
                 return 0;
 
+            if (mi_ctx->mv_source != AV_ME_SOURCE_ESTIMATE)
+                get_decoder_mvs(ctx);
+
             mi_ctx->me_ctx.linesize = mi_ctx->frames[0].avf->linesize[0];
             mi_ctx->me_ctx.data_cur = mi_ctx->frames[1].avf->data[0];
             mi_ctx->me_ctx.data_ref = mi_ctx->frames[2].avf->data[0];
@@ -798,6 +942,8 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
                     }
             }
 
+            emms_c();
+
             if (mi_ctx->vsbmc) {
 
                 for (i = 0; i < NB_CLUSTERS; i++) {
@@ -816,7 +962,9 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
 
                 mi_ctx->clusters[0].nb = mi_ctx->b_count;
 
-                if (ret = cluster_mvs(mi_ctx))
+                ret = cluster_mvs(mi_ctx);
+                emms_c();
+                if (ret)
                     return ret;
             }
         }
@@ -1152,6 +1300,8 @@ static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
 
                     }
 
+                emms_c();
+
                 set_frame_data(mi_ctx, alpha, avf_out);
             }
 
@@ -1238,6 +1388,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < 3; i++)
         av_freep(&mi_ctx->mv_table[i]);
+    for (i = 0; i < 2; i++)
+        av_freep(&mi_ctx->dec_mvs[i]);
 }
 
 static const AVFilterPad minterpolate_inputs[] = {
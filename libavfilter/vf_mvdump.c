@@ -0,0 +1,380 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Dump exported motion vectors to a binary file.
+ *
+ * The layout of the file is documented with the filter in doc/filters.texi.
+ */
+
+#include "config.h"
+
+#if CONFIG_ZLIB
+#include <zlib.h>
+#endif
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/motion_vector.h"
+#include "libavutil/opt.h"
+#include "libavformat/avio.h"
+
+#include "avfilter.h"
+#include "internal.h"
+#include "video.h"
+
+#define MVDUMP_VERSION      2
+#define HEADER_SIZE         16
+#define RECORD_HEADER_SIZE  24
+#define VECTOR_SIZE         32
+#define GRID_HEADER_SIZE    16
+#define ZBUF_SIZE           65536
+
+enum MVDumpMode {
+    MODE_VECTORS,
+    MODE_GRID,
+    MODE_TRAJECTORIES,
+    NB_MODES
+};
+
+enum MVDumpCompression {
+    COMPRESSION_NONE,
+    COMPRESSION_DEFLATE,
+    NB_COMPRESSIONS
+};
+
+typedef struct MVDumpContext {
+    const AVClass *class;
+    char *file_str;
+    int mode;
+    int compression;
+
+    AVIOContext *avio_context;
+    uint8_t *buf;
+    unsigned int buf_size;
+    int64_t frame_count;
+
+#if CONFIG_ZLIB
+    z_stream zstream;
+    int zstream_inited;
+    uint8_t *zbuf;
+#endif
+} MVDumpContext;
+
+#define OFFSET(x) offsetof(MVDumpContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption mvdump_options[] = {
+    { "file", "set file to write the motion vectors to", OFFSET(file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "f",    "set file to write the motion vectors to", OFFSET(file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "mode", "set which side data is written", OFFSET(mode), AV_OPT_TYPE_INT, {.i64=MODE_VECTORS}, 0, NB_MODES-1, FLAGS, "mode" },
+        { "vectors", "motion vector list",   0, AV_OPT_TYPE_CONST, {.i64=MODE_VECTORS}, 0, 0, FLAGS, "mode" },
+        { "grid",    "compact per-block grid", 0, AV_OPT_TYPE_CONST, {.i64=MODE_GRID},    0, 0, FLAGS, "mode" },
+        { "trajectories", "per-block trajectories", 0, AV_OPT_TYPE_CONST, {.i64=MODE_TRAJECTORIES}, 0, 0, FLAGS, "mode" },
+    { "compression", "set output compression", OFFSET(compression), AV_OPT_TYPE_INT, {.i64=COMPRESSION_NONE}, 0, NB_COMPRESSIONS-1, FLAGS, "compression" },
+        { "none",    "store as is",          0, AV_OPT_TYPE_CONST, {.i64=COMPRESSION_NONE},    0, 0, FLAGS, "compression" },
+        { "deflate", "zlib stream",          0, AV_OPT_TYPE_CONST, {.i64=COMPRESSION_DEFLATE}, 0, 0, FLAGS, "compression" },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(mvdump);
+
+static int write_data(AVFilterContext *ctx, const uint8_t *data, unsigned int size, int flush)
+{
+    MVDumpContext *s = ctx->priv;
+
+#if CONFIG_ZLIB
+    if (s->zstream_inited) {
+        int ret;
+
+        s->zstream.next_in  = data;
+        s->zstream.avail_in = size;
+        do {
+            s->zstream.next_out  = s->zbuf;
+            s->zstream.avail_out = ZBUF_SIZE;
+            ret = deflate(&s->zstream, flush ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR) {
+                av_log(ctx, AV_LOG_ERROR, "Deflate error\n");
+                return AVERROR_EXTERNAL;
+            }
+            avio_write(s->avio_context, s->zbuf, ZBUF_SIZE - s->zstream.avail_out);
+        } while (!s->zstream.avail_out);
+        return s->avio_context->error;
+    }
+#endif
+
+    avio_write(s->avio_context, data, size);
+    return s->avio_context->error;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MVDumpContext *s = ctx->priv;
+    int ret;
+
+    if (!s->file_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output file specified\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (s->compression == COMPRESSION_DEFLATE) {
+#if CONFIG_ZLIB
+        s->zbuf = av_malloc(ZBUF_SIZE);
+        if (!s->zbuf)
+            return AVERROR(ENOMEM);
+        if (deflateInit(&s->zstream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            av_log(ctx, AV_LOG_ERROR, "Could not initialize deflate\n");
+            return AVERROR_EXTERNAL;
+        }
+        s->zstream_inited = 1;
+#else
+        av_log(ctx, AV_LOG_ERROR, "Deflate compression requires zlib\n");
+        return AVERROR(ENOSYS);
+#endif
+    }
+
+    if (!strcmp("-", s->file_str))
+        ret = avio_open(&s->avio_context, "pipe:1", AVIO_FLAG_WRITE);
+    else
+        ret = avio_open(&s->avio_context, s->file_str, AVIO_FLAG_WRITE);
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Could not open %s: %s\n",
+               s->file_str, av_err2str(ret));
+        return ret;
+    }
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MVDumpContext *s = ctx->priv;
+
+#if CONFIG_ZLIB
+    if (s->zstream_inited) {
+        if (s->avio_context)
+            write_data(ctx, NULL, 0, 1);
+        deflateEnd(&s->zstream);
+        s->zstream_inited = 0;
+    }
+    av_freep(&s->zbuf);
+#endif
+    if (s->avio_context)
+        avio_closep(&s->avio_context);
+    av_freep(&s->buf);
+    s->buf_size = 0;
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    uint8_t header[HEADER_SIZE];
+
+    memcpy(header, "FFMV", 4);
+    AV_WL16(header +  4, MVDUMP_VERSION);
+    AV_WL16(header +  6, HEADER_SIZE);
+    AV_WL32(header +  8, inlink->time_base.num);
+    AV_WL32(header + 12, inlink->time_base.den);
+
+    return write_data(ctx, header, sizeof(header), 0);
+}
+
+static int write_vectors(AVFilterContext *ctx, const AVFrameSideData *sd, uint8_t *p)
+{
+    const AVMotionVector *mvs = (const AVMotionVector *)sd->data;
+    int i, nb_mvs = sd->size / sizeof(*mvs);
+
+    for (i = 0; i < nb_mvs; i++) {
+        const AVMotionVector *mv = &mvs[i];
+
+        AV_WL32(p,      mv->source);
+        p[4] = mv->w;
+        p[5] = mv->h;
+        AV_WL16(p +  6, mv->motion_scale);
+        AV_WL16(p +  8, mv->src_x);
+        AV_WL16(p + 10, mv->src_y);
+        AV_WL16(p + 12, mv->dst_x);
+        AV_WL16(p + 14, mv->dst_y);
+        AV_WL32(p + 16, mv->motion_x);
+        AV_WL32(p + 20, mv->motion_y);
+        AV_WL64(p + 24, mv->flags);
+        p += VECTOR_SIZE;
+    }
+
+    return nb_mvs;
+}
+
+static int write_grid(AVFilterContext *ctx, const AVFrameSideData *sd, uint8_t *p)
+{
+    AVMotionVectorsCompact *mvc = (AVMotionVectorsCompact *)sd->data;
+    unsigned int nb_blocks = mvc->nb_blocks_x * mvc->nb_blocks_y;
+    unsigned int list, i;
+
+    AV_WL32(p,     mvc->nb_blocks_x);
+    AV_WL32(p + 4, mvc->nb_blocks_y);
+    p[8] = mvc->block_w;
+    p[9] = mvc->block_h;
+    AV_WL16(p + 10, mvc->motion_scale);
+    p[12] = mvc->nb_lists;
+    p[13] = mvc->flags;
+    memset(p + 14, 0, 2);
+    p += GRID_HEADER_SIZE;
+
+    for (list = 0; list < mvc->nb_lists; list++) {
+        const int16_t *mv_x = av_motion_vectors_compact_mv_x(mvc, list);
+        const int16_t *mv_y = av_motion_vectors_compact_mv_y(mvc, list);
+
+        for (i = 0; i < nb_blocks; i++)
+            AV_WL16(p + 2 * i, mv_x[i]);
+        p += 2 * nb_blocks;
+        for (i = 0; i < nb_blocks; i++)
+            AV_WL16(p + 2 * i, mv_y[i]);
+        p += 2 * nb_blocks;
+        memcpy(p, av_motion_vectors_compact_ref(mvc, list), nb_blocks);
+        p += nb_blocks;
+    }
+
+    return nb_blocks;
+}
+
+static int write_trajectories(AVFilterContext *ctx, const AVFrameSideData *sd, uint8_t *p)
+{
+    AVMotionTrajectories *mt = (AVMotionTrajectories *)sd->data;
+    unsigned int nb_blocks = mt->nb_blocks_x * mt->nb_blocks_y;
+    const int32_t *x = av_motion_trajectories_x(mt);
+    const int32_t *y = av_motion_trajectories_y(mt);
+    const uint16_t *length = av_motion_trajectories_length(mt);
+    unsigned int i;
+
+    AV_WL32(p,     mt->nb_blocks_x);
+    AV_WL32(p + 4, mt->nb_blocks_y);
+    p[8] = mt->block_w;
+    p[9] = mt->block_h;
+    AV_WL16(p + 10, mt->motion_scale);
+    memset(p + 12, 0, 4);
+    p += GRID_HEADER_SIZE;
+
+    for (i = 0; i < nb_blocks; i++)
+        AV_WL32(p + 4 * i, x[i]);
+    p += 4 * nb_blocks;
+    for (i = 0; i < nb_blocks; i++)
+        AV_WL32(p + 4 * i, y[i]);
+    p += 4 * nb_blocks;
+    for (i = 0; i < nb_blocks; i++)
+        AV_WL16(p + 2 * i, length[i]);
+
+    return nb_blocks;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MVDumpContext *s = ctx->priv;
+    AVFrameSideData *sd;
+    size_t payload_size = 0;
+    int count = 0, ret;
+
+    if (s->mode == MODE_GRID) {
+        sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS_COMPACT);
+        if (sd) {
+            AVMotionVectorsCompact *mvc = (AVMotionVectorsCompact *)sd->data;
+            payload_size = GRID_HEADER_SIZE + (size_t)mvc->nb_blocks_x * mvc->nb_blocks_y *
+                                              mvc->nb_lists * 5;
+        }
+    } else if (s->mode == MODE_TRAJECTORIES) {
+        sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_TRAJECTORIES);
+        if (sd) {
+            AVMotionTrajectories *mt = (AVMotionTrajectories *)sd->data;
+            payload_size = GRID_HEADER_SIZE + (size_t)mt->nb_blocks_x * mt->nb_blocks_y * 10;
+        }
+    } else {
+        sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+        if (sd)
+            payload_size = sd->size / sizeof(AVMotionVector) * VECTOR_SIZE;
+    }
+
+    if (payload_size > UINT32_MAX - RECORD_HEADER_SIZE) {
+        av_frame_free(&frame);
+        return AVERROR(ERANGE);
+    }
+
+    av_fast_malloc(&s->buf, &s->buf_size, RECORD_HEADER_SIZE + payload_size);
+    if (!s->buf) {
+        s->buf_size = 0;
+        av_frame_free(&frame);
+        return AVERROR(ENOMEM);
+    }
+
+    if (sd) {
+        uint8_t *p = s->buf + RECORD_HEADER_SIZE;
+
+        if (s->mode == MODE_GRID)
+            count = write_grid(ctx, sd, p);
+        else if (s->mode == MODE_TRAJECTORIES)
+            count = write_trajectories(ctx, sd, p);
+        else
+            count = write_vectors(ctx, sd, p);
+    }
+
+    AV_WL32(s->buf,      RECORD_HEADER_SIZE - 4 + payload_size);
+    AV_WL64(s->buf +  4, frame->pts);
+    AV_WL32(s->buf + 12, s->frame_count++);
+    s->buf[16] = av_get_picture_type_char(frame->pict_type);
+    s->buf[17] = sd ? s->mode + 1 : 0;
+    AV_WL16(s->buf + 18, 0);
+    AV_WL32(s->buf + 20, count);
+
+    ret = write_data(ctx, s->buf, RECORD_HEADER_SIZE + payload_size, 0);
+    if (ret < 0) {
+        av_frame_free(&frame);
+        return ret;
+    }
+
+    return ff_filter_frame(ctx->outputs[0], frame);
+}
+
+static const AVFilterPad mvdump_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+        .config_props = config_input,
+    },
+    { NULL }
+};
+
+static const AVFilterPad mvdump_outputs[] = {
+    {
+        .name = "default",
+        .type = AVMEDIA_TYPE_VIDEO,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_mvdump = {
+    .name          = "mvdump",
+    .description   = NULL_IF_CONFIG_SMALL("Write exported motion vectors to a binary file."),
+    .priv_size     = sizeof(MVDumpContext),
+    .priv_class    = &mvdump_class,
+    .init          = init,
+    .uninit        = uninit,
+    .inputs        = mvdump_inputs,
+    .outputs       = mvdump_outputs,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+};
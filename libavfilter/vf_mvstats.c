@@ -0,0 +1,372 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Motion activity and scene change statistics computed from the exported
+ * motion vectors and macroblock types, without looking at the pixels.
+ */
+
+#include <float.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/motion_vector.h"
+#include "libavutil/opt.h"
+#include "libavutil/timestamp.h"
+#include "libavutil/video_enc_params.h"
+
+#include "avfilter.h"
+#include "internal.h"
+#include "motion_estimation.h"
+#include "video.h"
+
+typedef struct MVStatsContext {
+    const AVClass *class;
+    double threshold;
+    int nb_regions_x, nb_regions_y;
+
+    double *region_sum;                 ///< sum of the vector lengths weighted by the block area
+    double *region_area;                ///< inter coded area of each region
+
+    int64_t frame_count;
+    int64_t last_intra;                 ///< number of the last intra frame
+    int64_t max_gop;                    ///< longest distance seen between two intra frames
+    int nb_b_frames;                    ///< number of consecutive B-frames
+    int max_b_frames;
+    double prev_novelty;                ///< novelty of the last reference frame
+    int got_mvs;
+    int warned_no_mvs;
+} MVStatsContext;
+
+/**
+ * Statistics of one frame. Areas are relative to the frame area.
+ */
+typedef struct MVStats {
+    double energy;                      ///< mean vector length over the inter coded area
+    double intra;                       ///< intra coded area
+    double skip;                        ///< skipped area, negative if unknown
+    double coded;                       ///< area with motion vectors
+    double past;                        ///< area predicted from the past
+    double novelty;                     ///< area not predicted from the past
+    double pan_x, pan_y;                ///< global translation at the frame centre
+    double zoom;
+    double rotation;
+    double global;                      ///< share of the motion explained by the global model
+} MVStats;
+
+#define OFFSET(x) offsetof(MVStatsContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption mvstats_options[] = {
+    { "threshold", "set scene change detection threshold", OFFSET(threshold), AV_OPT_TYPE_DOUBLE, {.dbl=50.}, 0, 100., FLAGS },
+    { "t",         "set scene change detection threshold", OFFSET(threshold), AV_OPT_TYPE_DOUBLE, {.dbl=50.}, 0, 100., FLAGS },
+    { "regions",   "set the grid of regions of the motion energy", OFFSET(nb_regions_x), AV_OPT_TYPE_IMAGE_SIZE, {.str="1x1"}, 0, 0, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(mvstats);
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MVStatsContext *s = ctx->priv;
+    int nb_regions = s->nb_regions_x * s->nb_regions_y;
+
+    if (nb_regions > 1024) {
+        av_log(ctx, AV_LOG_ERROR, "Too many regions: %dx%d\n",
+               s->nb_regions_x, s->nb_regions_y);
+        return AVERROR(EINVAL);
+    }
+
+    s->region_sum  = av_calloc(nb_regions, sizeof(*s->region_sum));
+    s->region_area = av_calloc(nb_regions, sizeof(*s->region_area));
+    if (!s->region_sum || !s->region_area)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MVStatsContext *s = ctx->priv;
+
+    av_freep(&s->region_sum);
+    av_freep(&s->region_area);
+}
+
+/**
+ * Get the intra and skipped areas from the block types of the
+ * AV_FRAME_DATA_VIDEO_ENC_PARAMS side data.
+ *
+ * @return 0 if the block types were not exported
+ */
+static int get_block_types(AVFrame *frame, MVStats *st)
+{
+    AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_VIDEO_ENC_PARAMS);
+    AVVideoEncParams *par;
+    double area = (double)frame->width * frame->height;
+    double intra = 0, skip = 0;
+    unsigned int i;
+
+    if (!sd)
+        return 0;
+
+    par = (AVVideoEncParams *)sd->data;
+    for (i = 0; i < par->nb_blocks; i++) {
+        AVVideoBlockParams *b = av_video_enc_params_block(par, i);
+
+        if (b->type == AV_VIDEO_BLOCK_TYPE_UNKNOWN)
+            return 0;
+        if (b->type == AV_VIDEO_BLOCK_TYPE_INTRA)
+            intra += b->w * b->h;
+        else if (b->type == AV_VIDEO_BLOCK_TYPE_SKIP)
+            skip  += b->w * b->h;
+    }
+
+    st->intra = FFMIN(intra / area, 1.);
+    st->skip  = FFMIN(skip  / area, 1.);
+    return 1;
+}
+
+/**
+ * Accumulate the motion of the exported vectors and fit it with a global
+ * pan, zoom and rotation model. Vectors to future references are reversed,
+ * so all motion is expressed from the past to the future, and each vector
+ * of a bi-predicted block counts for half of its area.
+ */
+static void get_motion(MVStatsContext *s, AVFrame *frame,
+                       const AVFrameSideData *sd, MVStats *st)
+{
+    const AVMotionVector *mvs = (const AVMotionVector *)sd->data;
+    const int nb_mvs = sd->size / sizeof(*mvs);
+    const int nb_regions = s->nb_regions_x * s->nb_regions_y;
+    const double area = (double)frame->width * frame->height;
+    double sw = 0, sx = 0, sy = 0, sxx = 0, syy = 0;
+    double svx = 0, svy = 0, svv = 0, sxvx = 0, syvy = 0, sxvy = 0, syvx = 0;
+    double sum = 0, coded = 0, past = 0;
+    double mx, my, tx, ty, d, scale = 0, rot = 0, res;
+    int i;
+
+    memset(s->region_sum,  0, nb_regions * sizeof(*s->region_sum));
+    memset(s->region_area, 0, nb_regions * sizeof(*s->region_area));
+
+    for (i = 0; i < nb_mvs; i++) {
+        const AVMotionVector *mv = &mvs[i];
+        double w = mv->w * mv->h;
+        double x = mv->dst_x, y = mv->dst_y;
+        double vx, vy, len;
+        int rx, ry;
+
+        if (!mv->source || !w)
+            continue;
+
+        if (mv->motion_scale) {
+            vx = (double)mv->motion_x / mv->motion_scale;
+            vy = (double)mv->motion_y / mv->motion_scale;
+        } else {
+            vx = mv->src_x - mv->dst_x;
+            vy = mv->src_y - mv->dst_y;
+        }
+        if (mv->source < 0) {
+            vx = -vx;
+            vy = -vy;
+        }
+
+        if (mv->source < 0)
+            past  += w;
+        if (mv->flags & AV_MOTION_VECTOR_FLAG_BIPRED)
+            w *= 0.5;
+        coded += w;
+
+        len = sqrt(vx * vx + vy * vy);
+        sum += w * len;
+
+        rx = av_clip(mv->dst_x * s->nb_regions_x / frame->width,  0, s->nb_regions_x - 1);
+        ry = av_clip(mv->dst_y * s->nb_regions_y / frame->height, 0, s->nb_regions_y - 1);
+        s->region_sum [rx + ry * s->nb_regions_x] += w * len;
+        s->region_area[rx + ry * s->nb_regions_x] += w;
+
+        sw   += w;
+        sx   += w * x;
+        sy   += w * y;
+        sxx  += w * x * x;
+        syy  += w * y * y;
+        svx  += w * vx;
+        svy  += w * vy;
+        svv  += w * (vx * vx + vy * vy);
+        sxvx += w * x * vx;
+        syvy += w * y * vy;
+        sxvy += w * x * vy;
+        syvx += w * y * vx;
+    }
+
+    st->coded = FFMIN(coded / area, 1.);
+    st->past  = FFMIN(past  / area, 1.);
+
+    if (!sw)
+        return;
+
+    st->energy = sum / sw;
+
+    /* least squares fit of v = t + scale * p' + rot * perp(p'), with p'
+     * relative to the centroid of the blocks, which decouples the terms */
+    mx = sx  / sw;
+    my = sy  / sw;
+    tx = svx / sw;
+    ty = svy / sw;
+    d  = sxx - sw * mx * mx + syy - sw * my * my;
+    if (d > DBL_EPSILON) {
+        scale = (sxvx - mx * svx + syvy - my * svy) / d;
+        rot   = (sxvy - mx * svy - syvx + my * svx) / d;
+    }
+
+    st->pan_x    = tx + scale * (frame->width  / 2. - mx) - rot * (frame->height / 2. - my);
+    st->pan_y    = ty + scale * (frame->height / 2. - my) + rot * (frame->width  / 2. - mx);
+    st->zoom     = 1. + scale;
+    st->rotation = rot;
+
+    res = svv - sw * (tx * tx + ty * ty) - d * (scale * scale + rot * rot);
+    st->global = svv > DBL_EPSILON ? av_clipd(1. - res / svv, 0., 1.) : 1.;
+}
+
+static int set_meta(AVFrame *frame, const char *key, double value)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "%0.3f", value);
+    return av_dict_set(&frame->metadata, key, buf, 0);
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MVStatsContext *s = ctx->priv;
+    AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+    MVStats st = { .skip = -1, .zoom = 1., .global = 1. };
+    double score;
+    int has_types, i;
+
+    if (sd) {
+        s->got_mvs = 1;
+    } else if (frame->pict_type != AV_PICTURE_TYPE_I && !s->got_mvs) {
+        /* frames without any vector are all intra, unless the decoder
+         * does not export vectors at all */
+        ff_me_warn_no_decoder_mvs(ctx, &s->warned_no_mvs, 0);
+        return ff_filter_frame(ctx->outputs[0], frame);
+    }
+
+    if (sd)
+        get_motion(s, frame, sd, &st);
+
+    has_types = get_block_types(frame, &st);
+    if (frame->pict_type == AV_PICTURE_TYPE_I)
+        st.intra = 1.;
+    else if (!has_types)
+        st.intra = 1. - st.coded;
+    st.novelty = FFMAX(st.intra, 1. - st.past);
+
+    /* Intra frames are placed by the encoder, so only those breaking the
+     * usual GOP length, give or take the reordering delay of the B-frames,
+     * are likely scene changes. In P-frames a scene change
+     * shows as a rise of the area that cannot be predicted from the past.
+     * B-frames are not scored, as their choice between the past and future
+     * references depends more on their position than on the content. */
+    if (frame->pict_type == AV_PICTURE_TYPE_I) {
+        int64_t gop = s->frame_count - s->last_intra;
+
+        score = s->frame_count && gop + s->max_b_frames + 1 < s->max_gop ?
+                1. - s->prev_novelty : 0.;
+        s->max_gop      = FFMAX(s->max_gop, gop);
+        s->last_intra   = s->frame_count;
+        s->prev_novelty = st.novelty;
+    } else if (frame->pict_type != AV_PICTURE_TYPE_B) {
+        score = FFMAX(st.novelty - s->prev_novelty, 0.);
+        s->prev_novelty = st.novelty;
+    } else {
+        score = 0.;
+    }
+    score *= 100.;
+    s->frame_count++;
+
+    if (frame->pict_type == AV_PICTURE_TYPE_B) {
+        s->nb_b_frames++;
+        s->max_b_frames = FFMAX(s->max_b_frames, s->nb_b_frames);
+    } else {
+        s->nb_b_frames = 0;
+    }
+
+    set_meta(frame, "lavfi.mvstats.energy", st.energy);
+    set_meta(frame, "lavfi.mvstats.intra", st.intra);
+    if (st.skip >= 0)
+        set_meta(frame, "lavfi.mvstats.skip", st.skip);
+    set_meta(frame, "lavfi.mvstats.pan_x", st.pan_x);
+    set_meta(frame, "lavfi.mvstats.pan_y", st.pan_y);
+    set_meta(frame, "lavfi.mvstats.zoom", st.zoom);
+    set_meta(frame, "lavfi.mvstats.rotation", st.rotation);
+    set_meta(frame, "lavfi.mvstats.global", st.global);
+    set_meta(frame, "lavfi.mvstats.score", score);
+
+    if (s->nb_regions_x * s->nb_regions_y > 1) {
+        for (i = 0; i < s->nb_regions_x * s->nb_regions_y; i++) {
+            char key[64];
+
+            snprintf(key, sizeof(key), "lavfi.mvstats.energy.%d", i);
+            set_meta(frame, key, s->region_area[i] && sd ? s->region_sum[i] / s->region_area[i] : 0.);
+        }
+    }
+
+    if (score > s->threshold) {
+        char buf[AV_TS_MAX_STRING_SIZE];
+
+        av_ts_make_time_string(buf, frame->pts, &inlink->time_base);
+        av_log(ctx, AV_LOG_INFO, "lavfi.mvstats.score: %.3f, lavfi.mvstats.time: %s\n",
+               score, buf);
+        av_dict_set(&frame->metadata, "lavfi.mvstats.time", buf, 0);
+    }
+
+    return ff_filter_frame(ctx->outputs[0], frame);
+}
+
+static const AVFilterPad mvstats_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+static const AVFilterPad mvstats_outputs[] = {
+    {
+        .name = "default",
+        .type = AVMEDIA_TYPE_VIDEO,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_mvstats = {
+    .name          = "mvstats",
+    .description   = NULL_IF_CONFIG_SMALL("Compute motion statistics from the exported motion vectors."),
+    .priv_size     = sizeof(MVStatsContext),
+    .priv_class    = &mvstats_class,
+    .init          = init,
+    .uninit        = uninit,
+    .inputs        = mvstats_inputs,
+    .outputs       = mvstats_outputs,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+};
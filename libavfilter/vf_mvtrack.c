@@ -0,0 +1,470 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Accumulate the exported motion vectors of consecutive frames into block
+ * trajectories, exported as AV_FRAME_DATA_MOTION_TRAJECTORIES side data.
+ *
+ * The trajectory of a block is the one of the block it is predicted from in
+ * the reference, plus its own motion vector, so each frame costs one lookup
+ * per block and vector. Frames predicted from a future reference are held
+ * back until the trajectories of that reference are known.
+ */
+
+#include "libavutil/buffer.h"
+#include "libavutil/common.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libavutil/motion_vector.h"
+#include "libavutil/opt.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "internal.h"
+#include "motion_estimation.h"
+#include "video.h"
+
+/* number of frames kept, queued or as references */
+#define MAX_FRAMES   32
+/* number of frames that may wait for a future reference */
+#define MAX_PENDING  16
+#define MOTION_SCALE 16
+
+typedef struct TrackFrame {
+    AVFrame *frame;                     ///< frame waiting to be sent, NULL once sent
+    AVBufferRef *buf;                   ///< reference to the trajectories side data
+    AVMotionTrajectories *mt;
+    int64_t index;                      ///< position in display order
+    int anchor;                         ///< not a B-frame
+    int done;                           ///< trajectories computed
+} TrackFrame;
+
+typedef struct MVTrackContext {
+    const AVClass *class;
+    int block_size;
+    int nb_blocks_x, nb_blocks_y;
+
+    TrackFrame frames[MAX_FRAMES];
+    int64_t nb_in;                      ///< number of frames received
+    int64_t nb_out;                     ///< number of frames sent
+    int poc_step;                       ///< POC units per frame, 0 if unknown
+    int eof;
+    int got_mvs;
+    int warned_no_mvs;
+
+    /* per block accumulation of the trajectory candidates */
+    int64_t *sum_x, *sum_y;
+    int *count;
+    int *best_len;
+} MVTrackContext;
+
+#define OFFSET(x) offsetof(MVTrackContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption mvtrack_options[] = {
+    { "block_size", "set the size of the blocks tracked", OFFSET(block_size), AV_OPT_TYPE_INT, {.i64=8}, 4, 64, FLAGS },
+    { "bs",         "set the size of the blocks tracked", OFFSET(block_size), AV_OPT_TYPE_INT, {.i64=8}, 4, 64, FLAGS },
+    { "poc_step",   "set the POC units per frame of the extended motion vectors", OFFSET(poc_step), AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(mvtrack);
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MVTrackContext *s = ctx->priv;
+    int nb_blocks;
+
+    s->nb_blocks_x = (inlink->w + s->block_size - 1) / s->block_size;
+    s->nb_blocks_y = (inlink->h + s->block_size - 1) / s->block_size;
+    nb_blocks      = s->nb_blocks_x * s->nb_blocks_y;
+
+    s->sum_x    = av_calloc(nb_blocks, sizeof(*s->sum_x));
+    s->sum_y    = av_calloc(nb_blocks, sizeof(*s->sum_y));
+    s->count    = av_calloc(nb_blocks, sizeof(*s->count));
+    s->best_len = av_calloc(nb_blocks, sizeof(*s->best_len));
+    if (!s->sum_x || !s->sum_y || !s->count || !s->best_len)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MVTrackContext *s = ctx->priv;
+    int i;
+
+    for (i = 0; i < MAX_FRAMES; i++) {
+        av_frame_free(&s->frames[i].frame);
+        av_buffer_unref(&s->frames[i].buf);
+    }
+    av_freep(&s->sum_x);
+    av_freep(&s->sum_y);
+    av_freep(&s->count);
+    av_freep(&s->best_len);
+}
+
+static TrackFrame *get_frame(MVTrackContext *s, int64_t index)
+{
+    if (index < 0 || index < s->nb_in - MAX_FRAMES || index >= s->nb_in)
+        return NULL;
+    return &s->frames[index % MAX_FRAMES];
+}
+
+/**
+ * Find the frame a vector points to.
+ *
+ * With the extended vectors and a known POC step, the reference is given by
+ * its POC distance. Otherwise it is taken as the closest frame that is not a
+ * B-frame in the direction of the vector, which is exact for codecs without
+ * multiple or B-frame references.
+ *
+ * @param ref set to the reference, or NULL if it is not available
+ * @param force do not wait for references that are not decoded yet
+ * @return 0 if the reference is not known yet, 1 otherwise
+ */
+static int get_ref(MVTrackContext *s, const TrackFrame *cur,
+                   const AVMotionVector *mv, const AVMotionVectorExt *ext,
+                   int force, TrackFrame **ref)
+{
+    int64_t index;
+    int dir = mv->source < 0 ? -1 : 1;
+
+    *ref = NULL;
+
+    if (ext && ext->poc_delta != INT32_MIN && s->poc_step) {
+        if (!ext->poc_delta || ext->poc_delta % s->poc_step)
+            return 1;
+        index = cur->index + ext->poc_delta / s->poc_step;
+        if (index - cur->index > MAX_PENDING)
+            return 1;
+        *ref = get_frame(s, index);
+        if (!*ref)
+            return index < s->nb_in ? 1 : force || s->eof;
+    } else {
+        for (index = cur->index + dir; ; index += dir) {
+            *ref = get_frame(s, index);
+            if (!*ref)
+                return dir < 0 ? 1 : force || s->eof;
+            if ((*ref)->anchor)
+                break;
+        }
+    }
+
+    if (!(*ref)->done) {
+        *ref = NULL;
+        return force;
+    }
+    return 1;
+}
+
+static const AVMotionVector *get_mv(const uint8_t *mvs, int i, int mv_size,
+                                    int has_ext, const AVMotionVectorExt **ext)
+{
+    if (has_ext) {
+        *ext = (const AVMotionVectorExt *)(mvs + i * mv_size);
+        return &(*ext)->mv;
+    }
+    *ext = NULL;
+    return (const AVMotionVector *)(mvs + i * mv_size);
+}
+
+/**
+ * Compute the trajectories of a frame.
+ *
+ * @return 0 if it depends on a reference that is not known yet
+ */
+static int track_frame(AVFilterContext *ctx, TrackFrame *cur, int force)
+{
+    MVTrackContext *s = ctx->priv;
+    AVFrame *frame = cur->frame;
+    const AVFrameSideData *sd;
+    const AVMotionVectorExt *ext;
+    const uint8_t *mvs = NULL;
+    const int bs = s->block_size, nb_blocks = s->nb_blocks_x * s->nb_blocks_y;
+    int32_t *tx, *ty;
+    uint16_t *len;
+    int nb_mvs = 0, mv_size = 0, has_ext = 0;
+    int last_source = 0, last_poc_delta = 0;
+    int i;
+
+    sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS_EXT);
+    if (sd && sd->size >= sizeof(AVMotionVectorExt)) {
+        mv_size = ((const AVMotionVectorExt *)sd->data)->self_size;
+        if (mv_size < (int)sizeof(AVMotionVectorExt))
+            return AVERROR_INVALIDDATA;
+        has_ext = 1;
+    } else {
+        sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+        mv_size = sizeof(AVMotionVector);
+    }
+    if (sd) {
+        mvs    = sd->data;
+        nb_mvs = sd->size / mv_size;
+        s->got_mvs = 1;
+    }
+
+    /* poc_step needs the extended vectors to follow the exact references */
+    if (frame->pict_type != AV_PICTURE_TYPE_I &&
+        (!s->got_mvs || (s->poc_step && !has_ext)))
+        ff_me_warn_no_decoder_mvs(ctx, &s->warned_no_mvs, s->poc_step > 0);
+
+    if (frame->pict_type == AV_PICTURE_TYPE_I)
+        nb_mvs = 0;
+
+    /* check that all the references are known before changing anything */
+    for (i = 0; i < nb_mvs && !force; i++) {
+        const AVMotionVector *mv = get_mv(mvs, i, mv_size, has_ext, &ext);
+        TrackFrame *ref;
+
+        /* consecutive vectors mostly use the same reference */
+        if (!mv->source || (mv->source == last_source &&
+                            (!ext || ext->poc_delta == last_poc_delta)))
+            continue;
+        if (!get_ref(s, cur, mv, ext, 0, &ref))
+            return 0;
+        last_source    = mv->source;
+        last_poc_delta = ext ? ext->poc_delta : 0;
+    }
+
+    av_frame_remove_side_data(frame, AV_FRAME_DATA_MOTION_TRAJECTORIES);
+    cur->mt = av_motion_trajectories_create_side_data(frame, s->nb_blocks_x, s->nb_blocks_y);
+    if (!cur->mt)
+        return AVERROR(ENOMEM);
+    cur->buf = av_buffer_ref(av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_TRAJECTORIES)->buf);
+    if (!cur->buf)
+        return AVERROR(ENOMEM);
+    cur->mt->block_w      = bs;
+    cur->mt->block_h      = bs;
+    cur->mt->motion_scale = MOTION_SCALE;
+    cur->done = 1;
+
+    if (!nb_mvs)
+        return 1;
+
+    memset(s->count,    0, nb_blocks * sizeof(*s->count));
+    memset(s->best_len, 0, nb_blocks * sizeof(*s->best_len));
+
+    for (i = 0; i < nb_mvs; i++) {
+        const AVMotionVector *mv = get_mv(mvs, i, mv_size, has_ext, &ext);
+        int w = mv->w, h = mv->flags & AV_MOTION_VECTOR_FLAG_FIELD ? 2 * mv->h : mv->h;
+        int x0 = mv->dst_x - w / 2, y0 = mv->dst_y - h / 2;
+        int bx0, by0, bx1, by1, bx, by, mx, my, dist;
+        AVMotionTrajectories *rmt;
+        TrackFrame *ref;
+
+        if (!mv->source)
+            continue;
+        get_ref(s, cur, mv, ext, 1, &ref);
+        if (!ref)
+            continue;
+        rmt  = ref->mt;
+        dist = cur->index - ref->index;
+
+        if (mv->motion_scale) {
+            mx = av_rescale(mv->motion_x, MOTION_SCALE, mv->motion_scale);
+            my = av_rescale(mv->motion_y, MOTION_SCALE, mv->motion_scale);
+        } else {
+            mx = (mv->src_x - mv->dst_x) * MOTION_SCALE;
+            my = (mv->src_y - mv->dst_y) * MOTION_SCALE;
+        }
+
+        /* the blocks whose centre is covered by the vector */
+        bx0 = FFMAX(x0 - bs / 2 + bs - 1, 0) / bs;
+        by0 = FFMAX(y0 - bs / 2 + bs - 1, 0) / bs;
+        bx1 = FFMIN(FFMAX(x0 + w - bs / 2 + bs - 1, 0) / bs, s->nb_blocks_x);
+        by1 = FFMIN(FFMAX(y0 + h - bs / 2 + bs - 1, 0) / bs, s->nb_blocks_y);
+
+        for (by = by0; by < by1; by++) {
+            int ry = (by * bs + bs / 2) * MOTION_SCALE + my;
+
+            ry = av_clip(ry / (bs * MOTION_SCALE), 0, s->nb_blocks_y - 1) * s->nb_blocks_x;
+            for (bx = bx0; bx < bx1; bx++) {
+                int rx = (bx * bs + bs / 2) * MOTION_SCALE + mx;
+                int b  = bx + by * s->nb_blocks_x;
+                int l;
+
+                rx = av_clip(rx / (bs * MOTION_SCALE), 0, s->nb_blocks_x - 1) + ry;
+                /* trajectories starting after this frame are of no use */
+                l  = av_motion_trajectories_length(rmt)[rx] + dist;
+                if (l <= 0 || l < s->best_len[b])
+                    continue;
+                if (l > s->best_len[b]) {
+                    s->best_len[b] = l;
+                    s->count[b]    = 0;
+                    s->sum_x[b]    = 0;
+                    s->sum_y[b]    = 0;
+                }
+                s->count[b]++;
+                s->sum_x[b] += mx + av_motion_trajectories_x(rmt)[rx];
+                s->sum_y[b] += my + av_motion_trajectories_y(rmt)[rx];
+            }
+        }
+    }
+
+    tx  = av_motion_trajectories_x(cur->mt);
+    ty  = av_motion_trajectories_y(cur->mt);
+    len = av_motion_trajectories_length(cur->mt);
+    for (i = 0; i < nb_blocks; i++) {
+        if (!s->count[i])
+            continue;
+        tx[i]  = ROUNDED_DIV(s->sum_x[i], s->count[i]);
+        ty[i]  = ROUNDED_DIV(s->sum_y[i], s->count[i]);
+        len[i] = FFMIN(s->best_len[i], UINT16_MAX);
+    }
+
+    return 1;
+}
+
+/**
+ * Compute the trajectories of the queued frames whose references are known
+ * and send the frames that are done, in order.
+ *
+ * @param force compute the first queued frame even if some of its references
+ *              are missing
+ */
+static int flush_frames(AVFilterContext *ctx, int force)
+{
+    MVTrackContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    int64_t i;
+    int ret, progress;
+
+    do {
+        progress = 0;
+        for (i = s->nb_out; i < s->nb_in; i++) {
+            TrackFrame *cur = &s->frames[i % MAX_FRAMES];
+
+            if (cur->done)
+                continue;
+            ret = track_frame(ctx, cur, force && i == s->nb_out);
+            if (ret < 0)
+                return ret;
+            progress |= ret;
+        }
+        force = 0;
+    } while (progress);
+
+    while (s->nb_out < s->nb_in && s->frames[s->nb_out % MAX_FRAMES].done) {
+        TrackFrame *cur = &s->frames[s->nb_out++ % MAX_FRAMES];
+        AVFrame *frame = cur->frame;
+
+        cur->frame = NULL;
+        ret = ff_filter_frame(outlink, frame);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int add_frame(AVFilterContext *ctx, AVFrame *frame)
+{
+    MVTrackContext *s = ctx->priv;
+    TrackFrame *cur;
+    int ret;
+
+    /* make room, giving up on the references that do not come */
+    while (s->nb_in - s->nb_out >= MAX_PENDING) {
+        ret = flush_frames(ctx, 1);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+    }
+
+    cur = &s->frames[s->nb_in % MAX_FRAMES];
+    av_buffer_unref(&cur->buf);
+    cur->frame  = frame;
+    cur->mt     = NULL;
+    cur->index  = s->nb_in++;
+    cur->anchor = frame->pict_type != AV_PICTURE_TYPE_B;
+    cur->done   = 0;
+
+    return flush_frames(ctx, 0);
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink  = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    MVTrackContext *s = ctx->priv;
+    AVFrame *frame;
+    int64_t pts;
+    int ret, status;
+
+    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+
+    ret = ff_inlink_consume_frame(inlink, &frame);
+    if (ret < 0)
+        return ret;
+    if (ret > 0) {
+        ret = add_frame(ctx, frame);
+        if (ret < 0)
+            return ret;
+        if (ff_inlink_queued_frames(inlink)) {
+            ff_filter_set_ready(ctx, 100);
+            return 0;
+        }
+    }
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        s->eof = 1;
+        while (s->nb_out < s->nb_in) {
+            ret = flush_frames(ctx, 1);
+            if (ret < 0)
+                return ret;
+        }
+        ff_outlink_set_status(outlink, status, pts);
+        return 0;
+    }
+
+    FF_FILTER_FORWARD_WANTED(outlink, inlink);
+
+    return FFERROR_NOT_READY;
+}
+
+static const AVFilterPad mvtrack_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
+    },
+    { NULL }
+};
+
+static const AVFilterPad mvtrack_outputs[] = {
+    {
+        .name = "default",
+        .type = AVMEDIA_TYPE_VIDEO,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_mvtrack = {
+    .name          = "mvtrack",
+    .description   = NULL_IF_CONFIG_SMALL("Accumulate the exported motion vectors into block trajectories."),
+    .priv_size     = sizeof(MVTrackContext),
+    .priv_class    = &mvtrack_class,
+    .uninit        = uninit,
+    .activate      = activate,
+    .inputs        = mvtrack_inputs,
+    .outputs       = mvtrack_outputs,
+};
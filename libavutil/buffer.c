@@ -20,6 +20,13 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "config.h"
+#if HAVE_SCHED_YIELD
+#include <sched.h>
+#elif HAVE_SWITCHTOTHREAD
+#include <windows.h>
+#endif
+
 #include "avassert.h"
 #include "buffer_internal.h"
 #include "common.h"
@@ -231,6 +238,10 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
     pool->alloc     = av_buffer_alloc; // fallback
     pool->pool_free = pool_free;
 
+    atomic_init(&pool->pool, 0);
+    atomic_init(&pool->nb_popping, 0);
+    atomic_init(&pool->hits, 0);
+    atomic_init(&pool->misses, 0);
     atomic_init(&pool->refcount, 1);
 
     return pool;
@@ -247,6 +258,10 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
+    atomic_init(&pool->pool, 0);
+    atomic_init(&pool->nb_popping, 0);
+    atomic_init(&pool->hits, 0);
+    atomic_init(&pool->misses, 0);
     atomic_init(&pool->refcount, 1);
 
     return pool;
@@ -258,12 +273,14 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    BufferPoolEntry *buf = (BufferPoolEntry *)atomic_load(&pool->pool);
+
+    while (buf) {
+        BufferPoolEntry *next = buf->next;
 
         buf->free(buf->opaque, buf->data);
         av_freep(&buf);
+        buf = next;
     }
     ff_mutex_destroy(&pool->mutex);
 
@@ -286,6 +303,58 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
         buffer_pool_free(pool);
 }
 
+#define POOL_POP_SPIN 64
+
+/* let the thread that took the stack run and put it back */
+static void pool_yield(void)
+{
+#if HAVE_SCHED_YIELD
+    sched_yield();
+#elif HAVE_SWITCHTOTHREAD
+    SwitchToThread();
+#endif
+}
+
+/* push the list of entries from first to last onto the pool */
+static void pool_push(AVBufferPool *pool, BufferPoolEntry *first,
+                      BufferPoolEntry *last)
+{
+    intptr_t head = atomic_load_explicit(&pool->pool, memory_order_relaxed);
+
+    do {
+        last->next = (BufferPoolEntry *)head;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->pool, &head,
+                                                    (intptr_t)first,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static BufferPoolEntry *pool_pop(AVBufferPool *pool)
+{
+    BufferPoolEntry *buf, *rest, *last;
+    intptr_t empty = 0;
+
+    atomic_fetch_add_explicit(&pool->nb_popping, 1, memory_order_relaxed);
+    buf = (BufferPoolEntry *)atomic_exchange_explicit(&pool->pool, 0,
+                                                      memory_order_acq_rel);
+    if (buf && buf->next) {
+        rest      = buf->next;
+        buf->next = NULL;
+
+        /* usually nothing was returned to the pool in the meantime */
+        if (!atomic_compare_exchange_strong_explicit(&pool->pool, &empty,
+                                                     (intptr_t)rest,
+                                                     memory_order_release,
+                                                     memory_order_relaxed)) {
+            for (last = rest; last->next; last = last->next);
+            pool_push(pool, rest, last);
+        }
+    }
+    atomic_fetch_sub_explicit(&pool->nb_popping, 1, memory_order_release);
+
+    return buf;
+}
+
 static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
@@ -294,10 +363,7 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    pool_push(pool, buf, buf);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -334,24 +400,67 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
     return ret;
 }
 
+static AVBufferRef *pool_reuse_buffer(AVBufferPool *pool)
+{
+    AVBufferRef *ret;
+    BufferPoolEntry *buf = pool_pop(pool);
+
+    if (!buf)
+        return NULL;
+
+    ret = av_buffer_create(buf->data, pool->size, pool_release_buffer, buf, 0);
+    if (!ret)
+        pool_push(pool, buf, buf);
+
+    return ret;
+}
+
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 {
     AVBufferRef *ret;
-    BufferPoolEntry *buf;
+    int i, retried = 0;
+
+    ret = pool_reuse_buffer(pool);
+    /* The stack looks empty while another thread is popping from it. Wait
+     * a little for the rest of it to be put back rather than taking the
+     * lock. */
+    for (i = 0; !ret && i < POOL_POP_SPIN &&
+                atomic_load_explicit(&pool->nb_popping, memory_order_acquire); i++) {
+        pool_yield();
+        if (atomic_load_explicit(&pool->pool, memory_order_relaxed))
+            ret = pool_reuse_buffer(pool);
+    }
 
-    ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
-    if (buf) {
-        ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
-                               buf, 0);
-        if (ret) {
-            pool->pool = buf->next;
-            buf->next = NULL;
-        }
+    if (ret) {
+        atomic_fetch_add_explicit(&pool->hits, 1, memory_order_relaxed);
     } else {
-        ret = pool_alloc_buffer(pool);
+        ff_mutex_lock(&pool->mutex);
+        /* A buffer may have been returned while waiting for the lock. Only
+         * allocate once no other thread has the stack taken, as a preempted
+         * popping thread hides all the free buffers and fixed-size pools
+         * cannot allocate more. */
+        for (;;) {
+            ret = pool_reuse_buffer(pool);
+            if (ret) {
+                atomic_fetch_add_explicit(&pool->hits, 1, memory_order_relaxed);
+                break;
+            }
+            if (atomic_load_explicit(&pool->nb_popping, memory_order_acquire)) {
+                pool_yield();
+                continue;
+            }
+            ret = pool_alloc_buffer(pool);
+            if (ret) {
+                atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
+                break;
+            }
+            /* retry once if buffers came back while allocating */
+            if (retried++ ||
+                (!atomic_load(&pool->nb_popping) && !atomic_load(&pool->pool)))
+                break;
+        }
+        ff_mutex_unlock(&pool->mutex);
     }
-    ff_mutex_unlock(&pool->mutex);
 
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
@@ -359,6 +468,15 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     return ret;
 }
 
+void av_buffer_pool_get_stats(AVBufferPool *pool, uint64_t *hits,
+                              uint64_t *misses)
+{
+    if (hits)
+        *hits   = atomic_load_explicit(&pool->hits,   memory_order_relaxed);
+    if (misses)
+        *misses = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+}
+
 void *av_buffer_pool_buffer_get_opaque(AVBufferRef *ref)
 {
     BufferPoolEntry *buf = ref->buffer->opaque;
@@ -285,6 +285,18 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Get the usage statistics of a buffer pool.
+ * This function may be called simultaneously with av_buffer_pool_get().
+ *
+ * @param hits   if not NULL, set to the number of av_buffer_pool_get() calls
+ *               which reused a buffer returned to the pool
+ * @param misses if not NULL, set to the number of av_buffer_pool_get() calls
+ *               which allocated a new buffer
+ */
+void av_buffer_pool_get_stats(AVBufferPool *pool, uint64_t *hits,
+                              uint64_t *misses);
+
 /**
  * Query the original opaque parameter of an allocated buffer in the pool.
  *
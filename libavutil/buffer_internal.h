@@ -75,8 +75,24 @@ typedef struct BufferPoolEntry {
 } BufferPoolEntry;
 
 struct AVBufferPool {
+    /*
+     * Serializes the allocation of new buffers, some allocators rely on it.
+     * Getting a buffer from the pool and returning it does not take it.
+     */
     AVMutex mutex;
-    BufferPoolEntry *pool;
+
+    /*
+     * Stack of the available buffers, a BufferPoolEntry pointer. Buffers are
+     * pushed with compare-and-swap; to avoid the ABA problem, popping takes
+     * the whole stack and puts back all the entries but the first one.
+     */
+    atomic_intptr_t pool;
+    /* number of threads which have taken the stack to pop an entry */
+    atomic_uint nb_popping;
+
+    /* number of av_buffer_pool_get() calls served from/not from the pool */
+    atomic_uint_least64_t hits;
+    atomic_uint_least64_t misses;
 
     /*
      * This is used to track when the pool is to be freed.
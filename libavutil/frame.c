@@ -851,6 +851,9 @@ const char *av_frame_side_data_name(enum AVFrameSideDataType type)
     case AV_FRAME_DATA_DYNAMIC_HDR_PLUS: return "HDR Dynamic Metadata SMPTE2094-40 (HDR10+)";
     case AV_FRAME_DATA_REGIONS_OF_INTEREST: return "Regions Of Interest";
     case AV_FRAME_DATA_VIDEO_ENC_PARAMS:            return "Video encoding parameters";
+    case AV_FRAME_DATA_MOTION_VECTORS_COMPACT:      return "Motion vectors (compact)";
+    case AV_FRAME_DATA_MOTION_VECTORS_EXT:          return "Motion vectors (extended)";
+    case AV_FRAME_DATA_MOTION_TRAJECTORIES:         return "Motion trajectories";
     }
     return NULL;
 }
@@ -184,6 +184,25 @@ enum AVFrameSideDataType {
      * Encoding parameters for a video frame, as described by AVVideoEncParams.
      */
     AV_FRAME_DATA_VIDEO_ENC_PARAMS,
+
+    /**
+     * Motion vectors exported by some codecs, in the struct-of-arrays layout
+     * described by AVMotionVectorsCompact.
+     */
+    AV_FRAME_DATA_MOTION_VECTORS_COMPACT,
+
+    /**
+     * Motion vectors exported by some codecs, together with the identity of
+     * their reference. The data is an array of AVMotionVectorExt, see its
+     * documentation for how to walk it.
+     */
+    AV_FRAME_DATA_MOTION_VECTORS_EXT,
+
+    /**
+     * Cumulative motion of the blocks of the frame over the previous frames,
+     * as described by AVMotionTrajectories.
+     */
+    AV_FRAME_DATA_MOTION_TRAJECTORIES,
 };
 
 enum AVActiveFormatDescription {
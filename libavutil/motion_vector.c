@@ -0,0 +1,161 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "common.h"
+#include "frame.h"
+#include "mem.h"
+#include "motion_vector.h"
+
+#define PLANE_ALIGN 16
+
+AVMotionVectorsCompact *av_motion_vectors_compact_alloc(unsigned int nb_blocks_x,
+                                                        unsigned int nb_blocks_y,
+                                                        unsigned int nb_lists,
+                                                        size_t *out_size)
+{
+    AVMotionVectorsCompact *mvc;
+    size_t nb_blocks, mv_size, ref_size, size;
+    unsigned int i;
+
+    if (!nb_blocks_x || !nb_blocks_y || nb_lists < 1 || nb_lists > 2 ||
+        nb_blocks_x > INT_MAX / nb_blocks_y)
+        return NULL;
+
+    nb_blocks = (size_t)nb_blocks_x * nb_blocks_y;
+    mv_size   = FFALIGN(nb_blocks * sizeof(int16_t), PLANE_ALIGN);
+    ref_size  = FFALIGN(nb_blocks * sizeof(int8_t),  PLANE_ALIGN);
+    size      = FFALIGN(sizeof(*mvc), PLANE_ALIGN);
+    if ((INT_MAX - size) / nb_lists < 2 * mv_size + ref_size)
+        return NULL;
+
+    mvc = av_mallocz(size + nb_lists * (2 * mv_size + ref_size));
+    if (!mvc)
+        return NULL;
+
+    mvc->nb_blocks_x = nb_blocks_x;
+    mvc->nb_blocks_y = nb_blocks_y;
+    mvc->nb_lists    = nb_lists;
+
+    for (i = 0; i < nb_lists; i++) {
+        mvc->mv_x_offset[i] = size;
+        size += mv_size;
+        mvc->mv_y_offset[i] = size;
+        size += mv_size;
+    }
+    for (i = 0; i < nb_lists; i++) {
+        mvc->ref_offset[i] = size;
+        memset((uint8_t *)mvc + size, -1, nb_blocks);
+        size += ref_size;
+    }
+
+    if (out_size)
+        *out_size = size;
+
+    return mvc;
+}
+
+AVMotionVectorsCompact*
+av_motion_vectors_compact_create_side_data(AVFrame *frame,
+                                           unsigned int nb_blocks_x,
+                                           unsigned int nb_blocks_y,
+                                           unsigned int nb_lists)
+{
+    AVBufferRef            *buf;
+    AVMotionVectorsCompact *mvc;
+    size_t size;
+
+    mvc = av_motion_vectors_compact_alloc(nb_blocks_x, nb_blocks_y, nb_lists, &size);
+    if (!mvc)
+        return NULL;
+    buf = av_buffer_create((uint8_t *)mvc, size, NULL, NULL, 0);
+    if (!buf) {
+        av_freep(&mvc);
+        return NULL;
+    }
+
+    if (!av_frame_new_side_data_from_buf(frame, AV_FRAME_DATA_MOTION_VECTORS_COMPACT, buf)) {
+        av_buffer_unref(&buf);
+        return NULL;
+    }
+
+    return mvc;
+}
+
+AVMotionTrajectories *av_motion_trajectories_alloc(unsigned int nb_blocks_x,
+                                                   unsigned int nb_blocks_y,
+                                                   size_t *out_size)
+{
+    AVMotionTrajectories *mt;
+    size_t nb_blocks, pos_size, len_size, size;
+
+    if (!nb_blocks_x || !nb_blocks_y || nb_blocks_x > INT_MAX / nb_blocks_y)
+        return NULL;
+
+    nb_blocks = (size_t)nb_blocks_x * nb_blocks_y;
+    pos_size  = FFALIGN(nb_blocks * sizeof(int32_t),  PLANE_ALIGN);
+    len_size  = FFALIGN(nb_blocks * sizeof(uint16_t), PLANE_ALIGN);
+    size      = FFALIGN(sizeof(*mt), PLANE_ALIGN);
+    if ((INT_MAX - size - len_size) / 2 < pos_size)
+        return NULL;
+
+    mt = av_mallocz(size + 2 * pos_size + len_size);
+    if (!mt)
+        return NULL;
+
+    mt->nb_blocks_x   = nb_blocks_x;
+    mt->nb_blocks_y   = nb_blocks_y;
+    mt->x_offset      = size;
+    mt->y_offset      = size + pos_size;
+    mt->length_offset = size + 2 * pos_size;
+
+    if (out_size)
+        *out_size = size + 2 * pos_size + len_size;
+
+    return mt;
+}
+
+AVMotionTrajectories*
+av_motion_trajectories_create_side_data(AVFrame *frame,
+                                        unsigned int nb_blocks_x,
+                                        unsigned int nb_blocks_y)
+{
+    AVBufferRef          *buf;
+    AVMotionTrajectories *mt;
+    size_t size;
+
+    mt = av_motion_trajectories_alloc(nb_blocks_x, nb_blocks_y, &size);
+    if (!mt)
+        return NULL;
+    buf = av_buffer_create((uint8_t *)mt, size, NULL, NULL, 0);
+    if (!buf) {
+        av_freep(&mt);
+        return NULL;
+    }
+
+    if (!av_frame_new_side_data_from_buf(frame, AV_FRAME_DATA_MOTION_TRAJECTORIES, buf)) {
+        av_buffer_unref(&buf);
+        return NULL;
+    }
+
+    return mt;
+}
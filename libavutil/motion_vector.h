@@ -19,13 +19,17 @@
 #ifndef AVUTIL_MOTION_VECTOR_H
 #define AVUTIL_MOTION_VECTOR_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "attributes.h"
+#include "frame.h"
+
 typedef struct AVMotionVector {
     /**
      * Where the current macroblock comes from; negative value when it comes
      * from the past, positive value when it comes from the future.
-     * XXX: set exact relative ref frame reference instead of a +/- 1 "direction".
+     * The exact reference is exported through AVMotionVectorExt.
      */
     int32_t source;
     /**
@@ -41,8 +45,7 @@ typedef struct AVMotionVector {
      */
     int16_t dst_x, dst_y;
     /**
-     * Extra flag information.
-     * Currently unused.
+     * Extra flag information, a combination of AV_MOTION_VECTOR_FLAG_*.
      */
     uint64_t flags;
     /**
@@ -54,4 +57,273 @@ typedef struct AVMotionVector {
     uint16_t motion_scale;
 } AVMotionVector;
 
+/**
+ * The block only covers the lines of one field. w and h are then given in
+ * lines of that field, while the positions and the vector stay in frame
+ * lines, so that the relation between src, dst and motion holds.
+ */
+#define AV_MOTION_VECTOR_FLAG_FIELD         (1 << 0)
+/**
+ * Together with AV_MOTION_VECTOR_FLAG_FIELD, the block belongs to the
+ * bottom field.
+ */
+#define AV_MOTION_VECTOR_FLAG_BOTTOM_FIELD  (1 << 1)
+/**
+ * The vector was not coded but derived from the vectors of a reference
+ * picture (direct mode).
+ */
+#define AV_MOTION_VECTOR_FLAG_DIRECT        (1 << 2)
+/**
+ * The block is predicted from two references, and this vector is one of
+ * the two vectors exported for it.
+ */
+#define AV_MOTION_VECTOR_FLAG_BIPRED        (1 << 3)
+
+/**
+ * Motion vector with the identity of the reference it points to, exported as
+ * AV_FRAME_DATA_MOTION_VECTORS_EXT side data.
+ *
+ * The side data is an array of these structures. New fields may be added at
+ * the end of this structure, so readers must step through the array by the
+ * self_size of its first entry instead of sizeof(AVMotionVectorExt).
+ */
+typedef struct AVMotionVectorExt {
+    /**
+     * Must be set to the size of this data structure (that is,
+     * sizeof(AVMotionVectorExt)).
+     */
+    uint32_t self_size;
+    /**
+     * The vector itself, as exported in AV_FRAME_DATA_MOTION_VECTORS.
+     */
+    AVMotionVector mv;
+    /**
+     * Index of the reference in the reference list given by list. 0 for
+     * codecs with a single reference per list.
+     */
+    int32_t ref_idx;
+    /**
+     * Picture order count of the reference minus the one of the current
+     * picture (or field), i.e. the signed display order distance to the
+     * reference. INT32_MIN if unknown.
+     */
+    int32_t poc_delta;
+    /**
+     * Reference list the vector predicts from, 0 or 1. This is the list of
+     * the bitstream syntax, which does not imply a direction: e.g. an HEVC
+     * list 1 reference can lie in the past. Use poc_delta or the sign of
+     * mv.source for the direction.
+     */
+    int32_t list;
+} AVMotionVectorExt;
+
+/**
+ * Motion vector field in struct-of-arrays layout, exported as
+ * AV_FRAME_DATA_MOTION_VECTORS_COMPACT side data.
+ *
+ * The frame is covered by a regular grid of nb_blocks_x * nb_blocks_y blocks
+ * of block_w x block_h pixels. For each of the nb_lists reference lists there
+ * are three planes of nb_blocks_x * nb_blocks_y entries in raster order:
+ * - the horizontal and vertical motion, as int16_t in 1/motion_scale pixel
+ *   units, see av_motion_vectors_compact_mv_x() and
+ *   av_motion_vectors_compact_mv_y();
+ * - the reference index, as int8_t, see av_motion_vectors_compact_ref().
+ *   It is -1 when the block does not predict from this list, in which case
+ *   the motion is 0.
+ *
+ * Each plane starts at a 16-byte aligned offset from the start of this
+ * structure.
+ *
+ * Must be allocated with av_motion_vectors_compact_alloc(); its size is not a
+ * part of the public ABI.
+ */
+typedef struct AVMotionVectorsCompact {
+    /**
+     * Grid dimensions, in blocks.
+     */
+    unsigned int nb_blocks_x, nb_blocks_y;
+    /**
+     * Size of a grid block, in pixels.
+     */
+    unsigned int block_w, block_h;
+    /**
+     * Motion vectors are stored in units of 1/motion_scale pixel.
+     */
+    unsigned int motion_scale;
+    /**
+     * Number of reference lists, 1 or 2. These are the lists of the
+     * bitstream syntax, as in AVMotionVectorExt.list: list 0 is the forward
+     * or only list, but a list 1 reference does not necessarily lie in the
+     * future (e.g. H.264/HEVC generalized B pictures, VP9 compound
+     * prediction).
+     */
+    unsigned int nb_lists;
+    /**
+     * Offsets in bytes from the beginning of this structure at which the
+     * planes of each list start.
+     */
+    size_t mv_x_offset[2];
+    size_t mv_y_offset[2];
+    size_t ref_offset[2];
+    /**
+     * A combination of AV_MOTION_VECTORS_COMPACT_FLAG_*.
+     */
+    unsigned int flags;
+} AVMotionVectorsCompact;
+
+/**
+ * The picture was coded as two separate fields. The grid rows alternate
+ * between the top field (even rows) and the bottom field (odd rows), each
+ * row covering block_h lines of its field, i.e. 2 * block_h interleaved
+ * frame lines. The vertical motion is still given in frame lines. The
+ * reference index is not an index into a list but the parity of the
+ * reference field: 0 for the field of the same parity as the block, 1 for
+ * the opposite one.
+ */
+#define AV_MOTION_VECTORS_COMPACT_FLAG_FIELDS (1 << 0)
+
+/**
+ * Get the horizontal motion plane of the given reference list.
+ */
+static av_always_inline int16_t*
+av_motion_vectors_compact_mv_x(AVMotionVectorsCompact *mvc, unsigned int list)
+{
+    return (int16_t *)((uint8_t *)mvc + mvc->mv_x_offset[list]);
+}
+
+/**
+ * Get the vertical motion plane of the given reference list.
+ */
+static av_always_inline int16_t*
+av_motion_vectors_compact_mv_y(AVMotionVectorsCompact *mvc, unsigned int list)
+{
+    return (int16_t *)((uint8_t *)mvc + mvc->mv_y_offset[list]);
+}
+
+/**
+ * Get the reference index plane of the given reference list.
+ */
+static av_always_inline int8_t*
+av_motion_vectors_compact_ref(AVMotionVectorsCompact *mvc, unsigned int list)
+{
+    return (int8_t *)((uint8_t *)mvc + mvc->ref_offset[list]);
+}
+
+/**
+ * Allocates memory for AVMotionVectorsCompact of the given grid size and
+ * number of reference lists, including the planes. The planes are zeroed and
+ * the reference indices set to -1.
+ *
+ * @param out_size if non-NULL, the size in bytes of the resulting data array
+ *                 is written here
+ */
+AVMotionVectorsCompact *av_motion_vectors_compact_alloc(unsigned int nb_blocks_x,
+                                                        unsigned int nb_blocks_y,
+                                                        unsigned int nb_lists,
+                                                        size_t *out_size);
+
+/**
+ * Allocates memory for AVMotionVectorsCompact in the given AVFrame as
+ * AV_FRAME_DATA_MOTION_VECTORS_COMPACT side data, see
+ * av_motion_vectors_compact_alloc().
+ */
+AVMotionVectorsCompact*
+av_motion_vectors_compact_create_side_data(AVFrame *frame,
+                                           unsigned int nb_blocks_x,
+                                           unsigned int nb_blocks_y,
+                                           unsigned int nb_lists);
+
+/**
+ * Trajectories of the blocks of a frame, exported as
+ * AV_FRAME_DATA_MOTION_TRAJECTORIES side data.
+ *
+ * The frame is covered by a regular grid of nb_blocks_x * nb_blocks_y blocks
+ * of block_w x block_h pixels. For each block there are three planes of
+ * nb_blocks_x * nb_blocks_y entries in raster order:
+ * - the horizontal and vertical cumulative displacement, as int32_t in
+ *   1/motion_scale pixel units, see av_motion_trajectories_x() and
+ *   av_motion_trajectories_y(). Like the motion of AVMotionVector, it points
+ *   from the block to where its content was at the start of the trajectory:
+ *   origin_x = block centre x + x / motion_scale;
+ * - the length of the trajectory in frames, as uint16_t, see
+ *   av_motion_trajectories_length(). It is 0 when the trajectory starts in
+ *   this frame, e.g. in intra frames or intra coded blocks, in which case
+ *   the displacement is 0.
+ *
+ * Each plane starts at a 16-byte aligned offset from the start of this
+ * structure.
+ *
+ * Must be allocated with av_motion_trajectories_alloc(); its size is not a
+ * part of the public ABI.
+ */
+typedef struct AVMotionTrajectories {
+    /**
+     * Grid dimensions, in blocks.
+     */
+    unsigned int nb_blocks_x, nb_blocks_y;
+    /**
+     * Size of a grid block, in pixels.
+     */
+    unsigned int block_w, block_h;
+    /**
+     * Displacements are stored in units of 1/motion_scale pixel.
+     */
+    unsigned int motion_scale;
+    /**
+     * Offsets in bytes from the beginning of this structure at which the
+     * planes start.
+     */
+    size_t x_offset;
+    size_t y_offset;
+    size_t length_offset;
+} AVMotionTrajectories;
+
+/**
+ * Get the horizontal displacement plane.
+ */
+static av_always_inline int32_t*
+av_motion_trajectories_x(AVMotionTrajectories *mt)
+{
+    return (int32_t *)((uint8_t *)mt + mt->x_offset);
+}
+
+/**
+ * Get the vertical displacement plane.
+ */
+static av_always_inline int32_t*
+av_motion_trajectories_y(AVMotionTrajectories *mt)
+{
+    return (int32_t *)((uint8_t *)mt + mt->y_offset);
+}
+
+/**
+ * Get the trajectory length plane.
+ */
+static av_always_inline uint16_t*
+av_motion_trajectories_length(AVMotionTrajectories *mt)
+{
+    return (uint16_t *)((uint8_t *)mt + mt->length_offset);
+}
+
+/**
+ * Allocates memory for AVMotionTrajectories of the given grid size,
+ * including the zeroed planes.
+ *
+ * @param out_size if non-NULL, the size in bytes of the resulting data array
+ *                 is written here
+ */
+AVMotionTrajectories *av_motion_trajectories_alloc(unsigned int nb_blocks_x,
+                                                   unsigned int nb_blocks_y,
+                                                   size_t *out_size);
+
+/**
+ * Allocates memory for AVMotionTrajectories in the given AVFrame as
+ * AV_FRAME_DATA_MOTION_TRAJECTORIES side data, see
+ * av_motion_trajectories_alloc().
+ */
+AVMotionTrajectories*
+av_motion_trajectories_create_side_data(AVFrame *frame,
+                                        unsigned int nb_blocks_x,
+                                        unsigned int nb_blocks_y);
+
 #endif /* AVUTIL_MOTION_VECTOR_H */
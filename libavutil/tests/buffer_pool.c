@@ -0,0 +1,157 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program gets and returns buffers of a pool from several threads
+ * at once and checks that no buffer is handed out twice, that the hit/miss
+ * statistics add up and that a pool with a fixed number of buffers never
+ * fails to return one while enough of them are free.
+ */
+
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#define NB_THREADS    8
+#define NB_ITERATIONS 20000
+#define NB_HELD       3
+#define BUF_SIZE      64
+
+typedef struct ThreadArg {
+    AVBufferPool *pool;
+    int id;
+    int nb_held;
+    int errors;
+} ThreadArg;
+
+typedef struct FixedPool {
+    atomic_int nb_allocated;
+    int max_allocated;
+} FixedPool;
+
+static AVBufferRef *fixed_alloc(void *opaque, int size)
+{
+    FixedPool *fp = opaque;
+
+    if (atomic_fetch_add(&fp->nb_allocated, 1) >= fp->max_allocated) {
+        atomic_fetch_sub(&fp->nb_allocated, 1);
+        return NULL;
+    }
+    return av_buffer_alloc(size);
+}
+
+static void *thread_main(void *opaque)
+{
+    ThreadArg *arg = opaque;
+    AVBufferRef *bufs[NB_HELD];
+    int i, j, k;
+
+    for (i = 0; i < NB_ITERATIONS; i++) {
+        for (j = 0; j < arg->nb_held; j++) {
+            bufs[j] = av_buffer_pool_get(arg->pool);
+            if (!bufs[j]) {
+                arg->errors++;
+                continue;
+            }
+            memset(bufs[j]->data, arg->id * NB_HELD + j, BUF_SIZE);
+        }
+        /* another thread writing to the same buffer would show up here */
+        for (j = 0; j < arg->nb_held; j++) {
+            for (k = 0; bufs[j] && k < BUF_SIZE; k++) {
+                if (bufs[j]->data[k] != arg->id * NB_HELD + j) {
+                    arg->errors++;
+                    break;
+                }
+            }
+            av_buffer_unref(&bufs[j]);
+        }
+    }
+    return NULL;
+}
+
+static int run_threads(AVBufferPool *pool, int nb_held, const char *name)
+{
+    ThreadArg args[NB_THREADS];
+    pthread_t threads[NB_THREADS];
+    uint64_t hits, misses;
+    int i, errors = 0;
+
+    for (i = 0; i < NB_THREADS; i++) {
+        args[i] = (ThreadArg){ .pool = pool, .id = i, .nb_held = nb_held };
+        if (pthread_create(&threads[i], NULL, thread_main, &args[i])) {
+            fprintf(stderr, "pthread_create failed\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < NB_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].errors;
+    }
+
+    av_buffer_pool_get_stats(pool, &hits, &misses);
+    printf("%s: errors %d, gets %s, misses %s\n", name, errors,
+           hits + misses == (uint64_t)NB_THREADS * NB_ITERATIONS * nb_held ?
+           "ok" : "wrong",
+           misses <= NB_THREADS * nb_held ? "ok" : "too many");
+    return errors;
+}
+
+int main(void)
+{
+    AVBufferRef *bufs[NB_HELD];
+    AVBufferPool *pool;
+    FixedPool fp;
+    uint64_t hits, misses;
+    int i, round, ret = 0;
+
+    /* single thread: only the first round allocates */
+    pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    if (!pool)
+        return 1;
+    for (round = 0; round < 3; round++) {
+        for (i = 0; i < NB_HELD; i++)
+            bufs[i] = av_buffer_pool_get(pool);
+        for (i = 0; i < NB_HELD; i++)
+            av_buffer_unref(&bufs[i]);
+    }
+    av_buffer_pool_get_stats(pool, &hits, &misses);
+    printf("serial: hits %"PRIu64", misses %"PRIu64"\n", hits, misses);
+    av_buffer_pool_uninit(&pool);
+
+    pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    if (!pool)
+        return 1;
+    ret |= run_threads(pool, NB_HELD, "threaded");
+    av_buffer_pool_uninit(&pool);
+
+    /* exactly as many buffers as can be held at once */
+    atomic_init(&fp.nb_allocated, 0);
+    fp.max_allocated = NB_THREADS;
+    pool = av_buffer_pool_init2(BUF_SIZE, &fp, fixed_alloc, NULL);
+    if (!pool)
+        return 1;
+    ret |= run_threads(pool, 1, "fixed size");
+    av_buffer_pool_uninit(&pool);
+
+    return !!ret;
+}
@@ -0,0 +1,162 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "libavutil/common.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/motion_vector.h"
+
+/* check that a plane lies inside the allocation and is aligned */
+static int check_plane(const char *name, size_t offset, size_t plane_size, size_t size)
+{
+    if (offset % 16 || offset + plane_size > size) {
+        printf("%s: offset %zu, size %zu out of %zu\n", name, offset, plane_size, size);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_compact(unsigned int w, unsigned int h, unsigned int nb_lists)
+{
+    AVMotionVectorsCompact *mvc;
+    size_t size, nb_blocks = (size_t)w * h;
+    unsigned int list, i;
+    int errors = 0;
+
+    mvc = av_motion_vectors_compact_alloc(w, h, nb_lists, &size);
+    if (!mvc) {
+        printf("compact %ux%u, %u lists: alloc failed\n", w, h, nb_lists);
+        return 1;
+    }
+
+    for (list = 0; list < nb_lists; list++) {
+        const int16_t *mv_x = av_motion_vectors_compact_mv_x(mvc, list);
+        const int16_t *mv_y = av_motion_vectors_compact_mv_y(mvc, list);
+        const int8_t  *ref  = av_motion_vectors_compact_ref(mvc, list);
+
+        errors += check_plane("mv_x", mvc->mv_x_offset[list], nb_blocks * 2, size);
+        errors += check_plane("mv_y", mvc->mv_y_offset[list], nb_blocks * 2, size);
+        errors += check_plane("ref",  mvc->ref_offset[list],  nb_blocks,     size);
+        for (i = 0; i < nb_blocks; i++)
+            if (mv_x[i] || mv_y[i] || ref[i] != -1)
+                break;
+        if (i < nb_blocks)
+            errors++;
+    }
+
+    printf("compact %ux%u, %u lists: flags %u, errors %d\n",
+           w, h, nb_lists, mvc->flags, errors);
+    av_free(mvc);
+    return errors;
+}
+
+static int test_trajectories(unsigned int w, unsigned int h)
+{
+    AVMotionTrajectories *mt;
+    size_t size, nb_blocks = (size_t)w * h;
+    const int32_t *x, *y;
+    const uint16_t *length;
+    unsigned int i;
+    int errors = 0;
+
+    mt = av_motion_trajectories_alloc(w, h, &size);
+    if (!mt) {
+        printf("trajectories %ux%u: alloc failed\n", w, h);
+        return 1;
+    }
+
+    errors += check_plane("x",      mt->x_offset,      nb_blocks * 4, size);
+    errors += check_plane("y",      mt->y_offset,      nb_blocks * 4, size);
+    errors += check_plane("length", mt->length_offset, nb_blocks * 2, size);
+    x      = av_motion_trajectories_x(mt);
+    y      = av_motion_trajectories_y(mt);
+    length = av_motion_trajectories_length(mt);
+    for (i = 0; i < nb_blocks; i++)
+        if (x[i] || y[i] || length[i])
+            break;
+    if (i < nb_blocks)
+        errors++;
+
+    printf("trajectories %ux%u: errors %d\n", w, h, errors);
+    av_free(mt);
+    return errors;
+}
+
+static int test_side_data(void)
+{
+    AVFrame *frame = av_frame_alloc();
+    AVMotionVectorsCompact *mvc;
+    AVMotionTrajectories *mt;
+    AVFrameSideData *sd;
+    size_t size;
+    int errors = 0;
+
+    if (!frame)
+        return 1;
+
+    mvc = av_motion_vectors_compact_create_side_data(frame, 45, 36, 2);
+    sd  = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS_COMPACT);
+    av_free(av_motion_vectors_compact_alloc(45, 36, 2, &size));
+    if (!mvc || !sd || sd->data != (uint8_t *)mvc || sd->size != size)
+        errors++;
+
+    mt = av_motion_trajectories_create_side_data(frame, 90, 72);
+    sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_TRAJECTORIES);
+    av_free(av_motion_trajectories_alloc(90, 72, &size));
+    if (!mt || !sd || sd->data != (uint8_t *)mt || sd->size != size)
+        errors++;
+
+    printf("side data: errors %d\n", errors);
+    av_frame_free(&frame);
+    return errors;
+}
+
+int main(void)
+{
+    static const unsigned int sizes[][2] = {
+        { 1, 1 }, { 3, 5 }, { 45, 36 }, { 240, 135 },
+    };
+    unsigned int i;
+    int ret = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        ret |= test_compact(sizes[i][0], sizes[i][1], 1);
+        ret |= test_compact(sizes[i][0], sizes[i][1], 2);
+        ret |= test_trajectories(sizes[i][0], sizes[i][1]);
+    }
+
+    /* invalid sizes are rejected */
+    printf("compact 0 lists: %s\n",
+           av_motion_vectors_compact_alloc(4, 4, 0, NULL) ? "accepted" : "rejected");
+    printf("compact 3 lists: %s\n",
+           av_motion_vectors_compact_alloc(4, 4, 3, NULL) ? "accepted" : "rejected");
+    printf("compact 0x4: %s\n",
+           av_motion_vectors_compact_alloc(0, 4, 1, NULL) ? "accepted" : "rejected");
+    printf("compact %ux%u: %s\n", UINT_MAX, 2U,
+           av_motion_vectors_compact_alloc(UINT_MAX, 2, 1, NULL) ? "accepted" : "rejected");
+    printf("trajectories %ux%u: %s\n", 65536U, 65536U,
+           av_motion_trajectories_alloc(65536, 65536, NULL) ? "accepted" : "rejected");
+
+    ret |= test_side_data();
+
+    return !!ret;
+}
@@ -55,6 +55,30 @@ enum AVVideoEncParamsType {
      *   as AVVideoBlockParams.qp_delta.
      */
     AV_VIDEO_ENC_PARAMS_H264,
+
+    /**
+     * MPEG-1/2/4, H.261, H.263, VC-1 and RealVideo store a per-macroblock
+     * quantiser scale (qscale), exported as AVVideoBlockParams.delta_qp,
+     * with AVVideoEncParams.qp set to 0.
+     */
+    AV_VIDEO_ENC_PARAMS_MPEG,
+};
+
+/**
+ * Coding type of a block, see AVVideoBlockParams.type.
+ */
+enum AVVideoBlockType {
+    AV_VIDEO_BLOCK_TYPE_UNKNOWN = 0,
+    AV_VIDEO_BLOCK_TYPE_INTRA,
+    /**
+     * Predicted from one or more references, with coded vectors and/or
+     * residual.
+     */
+    AV_VIDEO_BLOCK_TYPE_INTER,
+    /**
+     * Predicted without any coded vector difference or residual.
+     */
+    AV_VIDEO_BLOCK_TYPE_SKIP,
 };
 
 /**
@@ -126,6 +150,17 @@ typedef struct AVVideoBlockParams {
      * corresponding per-frame value.
      */
     int32_t delta_qp;
+
+    /**
+     * Coding type of the block, AV_VIDEO_BLOCK_TYPE_UNKNOWN if not exported.
+     */
+    enum AVVideoBlockType type;
+    /**
+     * Width and height in luma pixels of the prediction partitions the block
+     * is split into, e.g. 16x8 for a 16x16 macroblock predicted as two
+     * halves. 0 if not exported.
+     */
+    int part_w, part_h;
 } AVVideoBlockParams;
 
 /*
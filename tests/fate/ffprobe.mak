@@ -29,6 +29,11 @@ FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+# extended motion vectors of a B-frame stream, with their reference list
+FATE_FFPROBE-$(call ENCDEC, MPEG4, AVI) += fate-ffprobe-motion-vectors-ext
+fate-ffprobe-motion-vectors-ext: fate-vsynth1-mpeg4-qprd
+fate-ffprobe-motion-vectors-ext: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -export_side_data +mvs_ext -show_motion_vectors -of compact $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi | do_md5sum - | cut -d " " -f1
+
 FATE_FFPROBE += $(FATE_FFPROBE-yes)
 
 fate-ffprobe: $(FATE_FFPROBE)
@@ -126,6 +126,9 @@ FATE_FILTER-$(call ALLYES, MINTERPOLATE_FILTER TESTSRC2_FILTER) += fate-filter-m
 fate-filter-minterpolate-up: CMD = framecrc -lavfi testsrc2=r=2:d=10,framerate=fps=10 -t 1
 fate-filter-minterpolate-down: CMD = framecrc -lavfi testsrc2=r=2:d=10,framerate=fps=1 -t 1
 
+FATE_FILTER-$(call ALLYES, MINTERPOLATE_FILTER TESTSRC2_FILTER) += fate-filter-minterpolate-vsbmc
+fate-filter-minterpolate-vsbmc: CMD = framecrc -lavfi testsrc2=r=5:d=1,minterpolate=fps=10:mi_mode=mci:mc_mode=aobmc:vsbmc=1 -t 0.6
+
 FATE_FILTER_VSYNTH-$(CONFIG_BOXBLUR_FILTER) += fate-filter-boxblur
 fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf boxblur=2:1
 
@@ -207,6 +210,15 @@ FATE_FILTER_VSYNTH-$(CONFIG_HSTACK_FILTER) += fate-filter-hstack
 fate-filter-hstack: tests/data/filtergraphs/hstack
 fate-filter-hstack: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/hstack
 
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER BOXBLUR_FILTER HFLIP_FILTER NEGATE_FILTER VFLIP_FILTER LUTYUV_FILTER HSTACK_FILTER) += fate-filter-split-branches fate-filter-split-branches-graph-threads
+fate-filter-split-branches: tests/data/filtergraphs/split-branches
+fate-filter-split-branches: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/split-branches
+
+# same graph with the branches activated concurrently, must match the serial run
+fate-filter-split-branches-graph-threads: tests/data/filtergraphs/split-branches
+fate-filter-split-branches-graph-threads: CMD = framecrc -filter_complex_threads 4 -filter_thread_type slice+graph -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/split-branches
+fate-filter-split-branches-graph-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-split-branches
+
 FATE_FILTER_VSYNTH-$(CONFIG_VSTACK_FILTER) += fate-filter-vstack
 fate-filter-vstack: tests/data/filtergraphs/vstack
 fate-filter-vstack: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/vstack
@@ -574,6 +586,41 @@ FATE_FILTER_VSYNTH-$(CONFIG_CODECVIEW_FILTER) += fate-filter-codecview
 fate-filter-codecview: fate-vsynth1-mpeg4-qprd
 fate-filter-codecview: CMD = framecrc -flags bitexact -idct simple -flags2 +export_mvs -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -frames:v 5 -flags +bitexact -vf codecview=mv=pf+bf+bb
 
+FATE_FILTER_VSYNTH-$(CONFIG_MVDUMP_FILTER) += fate-filter-mvdump fate-filter-mvdump-grid
+fate-filter-mvdump: fate-vsynth1-mpeg4-qprd
+fate-filter-mvdump: CMD = ffmpeg -flags2 +export_mvs -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -vf trim=end_frame=10,mvdump=f=- -f null - | do_md5sum - | cut -d " " -f1
+fate-filter-mvdump-grid: fate-vsynth1-mpeg4-qprd
+fate-filter-mvdump-grid: CMD = ffmpeg -export_side_data +mvs_compact -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -vf trim=end_frame=10,mvdump=f=-:mode=grid -f null - | do_md5sum - | cut -d " " -f1
+
+FATE_FILTER_VSYNTH-$(call ALLYES, MESTIMATE_FILTER MVDUMP_FILTER) += fate-filter-mestimate-decoder fate-filter-mestimate-hybrid
+fate-filter-mestimate-decoder: fate-vsynth1-mpeg4-qprd
+fate-filter-mestimate-decoder: CMD = ffmpeg -flags2 +export_mvs -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -vf trim=end_frame=10,mestimate=mv_source=decoder,mvdump=f=- -f null - | do_md5sum - | cut -d " " -f1
+fate-filter-mestimate-hybrid: fate-vsynth1-mpeg4-qprd
+fate-filter-mestimate-hybrid: CMD = ffmpeg -flags2 +export_mvs -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -vf trim=end_frame=10,mestimate=mv_source=hybrid,mvdump=f=- -f null - | do_md5sum - | cut -d " " -f1
+
+FATE_FILTER_VSYNTH-$(CONFIG_MINTERPOLATE_FILTER) += fate-filter-minterpolate-decoder fate-filter-minterpolate-hybrid fate-filter-minterpolate-poc-step
+fate-filter-minterpolate-decoder: fate-vsynth1-mpeg4-qprd
+fate-filter-minterpolate-decoder: CMD = framecrc -flags bitexact -idct simple -flags2 +export_mvs -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -flags +bitexact -vf trim=end_frame=6,minterpolate=fps=50:mv_source=decoder
+fate-filter-minterpolate-hybrid: fate-vsynth1-mpeg4-qprd
+fate-filter-minterpolate-hybrid: CMD = framecrc -flags bitexact -idct simple -flags2 +export_mvs -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -flags +bitexact -vf trim=end_frame=6,minterpolate=fps=50:mv_source=hybrid:me=ds
+# the extended vectors give the same references as the plain ones on this file
+fate-filter-minterpolate-poc-step: fate-vsynth1-mpeg4-qprd
+fate-filter-minterpolate-poc-step: CMD = framecrc -flags bitexact -idct simple -flags2 +export_mvs -export_side_data +mvs_ext -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -flags +bitexact -vf trim=end_frame=6,minterpolate=fps=50:mv_source=decoder:poc_step=2
+fate-filter-minterpolate-poc-step: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-decoder
+
+FATE_FILTER_VSYNTH-$(call ALLYES, MVSTATS_FILTER METADATA_FILTER) += fate-filter-mvstats
+fate-filter-mvstats: fate-vsynth1-mpeg4-qprd
+fate-filter-mvstats: CMD = ffmpeg -flags2 +export_mvs -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi -vf trim=end_frame=10,mvstats,metadata=print:file=- -f null -
+
+FATE_FILTER_VSYNTH-$(call ALLYES, MVTRACK_FILTER MVDUMP_FILTER) += fate-filter-mvtrack fate-filter-mvtrack-mvs-only
+fate-filter-mvtrack: fate-vsynth1-mpeg2-ivlc-qprd
+fate-filter-mvtrack: CMD = ffmpeg -flags2 +export_mvs -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg2-ivlc-qprd.mpeg2video -vf trim=end_frame=12,mvtrack,mvdump=f=-:mode=trajectories -f null - | do_md5sum - | cut -d " " -f1
+
+# the trajectories only depend on the vectors, not on the reconstruction
+fate-filter-mvtrack-mvs-only: fate-vsynth1-mpeg2-ivlc-qprd
+fate-filter-mvtrack-mvs-only: CMD = ffmpeg -flags2 +export_mvs+mvs_only -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg2-ivlc-qprd.mpeg2video -vf trim=end_frame=12,mvtrack,mvdump=f=-:mode=trajectories -f null - | do_md5sum - | cut -d " " -f1
+fate-filter-mvtrack-mvs-only: REF = $(SRC_PATH)/tests/ref/fate/filter-mvtrack
+
 FATE_FILTER_VSYNTH-$(call ALLYES, QP_FILTER PP_FILTER) += fate-filter-qp
 fate-filter-qp: CMD = video_filter "qp=17,pp=be/hb/vb/tn/l5/al"
 
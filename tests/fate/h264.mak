@@ -197,7 +197,8 @@ FATE_H264  := $(FATE_H264:%=fate-h264-conformance-%)                    \
               fate-h264-missing-frame                                   \
               fate-h264-ref-pic-mod-overflow                            \
               fate-h264-timecode                                        \
-              fate-h264-encparams
+              fate-h264-encparams                                       \
+              fate-h264-frame-slice-threads
 
 FATE_H264-$(call DEMDEC, H264, H264) += $(FATE_H264)
 FATE_H264-$(call DEMDEC,  MOV, H264) += fate-h264-crop-to-container
@@ -448,5 +449,9 @@ fate-h264-reinit-%:                               CMD = framecrc -i $(TARGET_SAM
 
 fate-h264-dts_5frames:                            CMD = probeframes $(TARGET_SAMPLES)/h264/dts_5frames.mkv
 
+# slice threads nested in frame threads must decode like a single thread
+fate-h264-frame-slice-threads: CMD = threads=3 thread_type=frame+slice framecrc -framerate 19 -slice_threads 3 -i $(TARGET_SAMPLES)/h264-conformance/BA1_FT_C.264
+fate-h264-frame-slice-threads: REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-ba1_ft_c
+
 fate-h264-encparams: CMD = venc_data $(TARGET_SAMPLES)/h264-conformance/FRext/FRExt_MMCO4_Sony_B.264 0 1
 FATE_SAMPLES_DUMP_DATA += fate-h264-encparams
@@ -270,6 +270,14 @@ FATE_HEVC_FFPROBE-$(call DEMDEC, HEVC, HEVC) += fate-hevc-paired-fields
 fate-hevc-monochrome-crop: CMD = probeframes -show_entries frame=width,height:stream=width,height $(TARGET_SAMPLES)/hevc/hevc-monochrome.hevc
 FATE_HEVC_FFPROBE-$(call DEMDEC, HEVC, HEVC) += fate-hevc-monochrome-crop
 
+# motion vectors exported by the decoder, plain, with their references and as a compact grid
+fate-hevc-mvs: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs -show_motion_vectors -of compact $(TARGET_SAMPLES)/hevc-conformance/AMVP_A_MTK_4.bit | do_md5sum - | cut -d " " -f1
+fate-hevc-mvs-ext: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs_ext -show_motion_vectors -of compact $(TARGET_SAMPLES)/hevc-conformance/AMVP_A_MTK_4.bit | do_md5sum - | cut -d " " -f1
+FATE_HEVC_FFPROBE-$(call DEMDEC, HEVC, HEVC) += fate-hevc-mvs fate-hevc-mvs-ext
+
+fate-hevc-mvs-compact: CMD = ffmpeg -export_side_data +mvs_compact -i $(TARGET_SAMPLES)/hevc-conformance/AMVP_A_MTK_4.bit -vf mvdump=f=-:mode=grid -f null - | do_md5sum - | cut -d " " -f1
+FATE_HEVC-$(call ALLYES, HEVC_DEMUXER HEVC_DECODER MVDUMP_FILTER) += fate-hevc-mvs-compact
+
 fate-hevc-two-first-slice: CMD = threads=2 framemd5 -i $(TARGET_SAMPLES)/hevc/two_first_slice.mp4 -sws_flags bitexact -t 00:02.00 -an
 FATE_HEVC-$(call DEMDEC, MOV, HEVC) += fate-hevc-two-first-slice
 
@@ -80,8 +80,18 @@ fate-vc1test_smm0015: CMD = framecrc -i $(TARGET_SAMPLES)/vc1/SMM0015.rcv
 FATE_VC1-$(CONFIG_MOV_DEMUXER) += fate-vc1-ism
 fate-vc1-ism: CMD = framecrc -i $(TARGET_SAMPLES)/isom/vc1-wmapro.ism -an
 
+# motion vectors of a progressive and an interlaced stream, the latter also
+# as a compact grid with its interleaved field layout
+fate-vc1-mvs: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs -show_motion_vectors -of compact $(TARGET_SAMPLES)/vc1/SA00040.vc1 | do_md5sum - | cut -d " " -f1
+fate-vc1-ilaced-mvs: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs -show_motion_vectors -of compact $(TARGET_SAMPLES)/vc1/ilaced_twomv.vc1 | do_md5sum - | cut -d " " -f1
+FATE_VC1_FFPROBE-$(call DEMDEC, VC1, VC1) += fate-vc1-mvs fate-vc1-ilaced-mvs
+
+fate-vc1-ilaced-mvs-compact: CMD = ffmpeg -export_side_data +mvs_compact -i $(TARGET_SAMPLES)/vc1/ilaced_twomv.vc1 -vf mvdump=f=-:mode=grid -f null - | do_md5sum - | cut -d " " -f1
+FATE_VC1-$(call ALLYES, VC1_DEMUXER MVDUMP_FILTER) += fate-vc1-ilaced-mvs-compact
+
 FATE_MICROSOFT-$(CONFIG_VC1_DECODER) += $(FATE_VC1-yes)
-fate-vc1: $(FATE_VC1-yes)
+FATE_SAMPLES_FFPROBE += $(FATE_VC1_FFPROBE-yes)
+fate-vc1: $(FATE_VC1-yes) $(FATE_VC1_FFPROBE-yes)
 
 FATE_MICROSOFT-$(CONFIG_ASF_DEMUXER) += fate-asf-repldata
 fate-asf-repldata: CMD = framecrc -i $(TARGET_SAMPLES)/asf/bug821-2.asf -c copy
@@ -79,8 +79,15 @@ fate-webm-dash-manifest-live-bandwidth: CMD = run $(FFMPEG) -nostdin -f webm_das
 FATE_VP8-$(call DEMDEC, MATROSKA, VP8) += fate-vp8-2451
 fate-vp8-2451: CMD = framecrc -flags +bitexact -i $(TARGET_SAMPLES)/vp8/RRSF49-short.webm -vsync cfr -an
 
+# motion vectors of the bottom-up (EA) and top-down (Flash) VP6 streams
+fate-vp6-mvs: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs -show_motion_vectors -of compact $(TARGET_SAMPLES)/ea-vp6/g36.vp6 | do_md5sum - | cut -d " " -f1
+fate-vp6f-mvs: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs -show_motion_vectors -of compact $(TARGET_SAMPLES)/flash-vp6/clip1024.flv | do_md5sum - | cut -d " " -f1
+FATE_VP6_FFPROBE-$(call DEMDEC, EA, VP6) += fate-vp6-mvs
+FATE_VP6_FFPROBE-$(call DEMDEC, FLV, VP6F) += fate-vp6f-mvs
+
 FATE_SAMPLES_AVCONV += $(FATE_VP6-yes)
-fate-vp6: $(FATE_VP6-yes)
+FATE_SAMPLES_FFPROBE += $(FATE_VP6_FFPROBE-yes)
+fate-vp6: $(FATE_VP6-yes) $(FATE_VP6_FFPROBE-yes)
 
 FATE_SAMPLES_AVCONV-$(call DEMDEC, AVI, VP7) += fate-vp7
 fate-vp7: CMD = framecrc -flags +bitexact -i $(TARGET_SAMPLES)/vp7/potter-40.vp7 -frames 30 -an
@@ -109,8 +116,17 @@ endef
 
 $(eval $(call FATE_VP8_FULL))
 
+# motion vectors of the comprehensive test vectors, which cover the split MV layouts
+define FATE_VP8_MVS
+FATE_VP8_FFPROBE-$(call DEMDEC, IVF, VP8) += fate-vp8-test-vector-mvs-$(1)
+fate-vp8-test-vector-mvs-$(1): CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs -show_motion_vectors -of compact $(TARGET_SAMPLES)/vp8-test-vectors-r1/vp80-00-comprehensive-$(1).ivf | do_md5sum - | cut -d " " -f1
+endef
+
+$(foreach N,$(VP8_SUITE),$(eval $(call FATE_VP8_MVS,$(N))))
+
 FATE_SAMPLES_AVCONV += $(FATE_VP8-yes)
-fate-vp8: $(FATE_VP8-yes)
+FATE_SAMPLES_FFPROBE += $(FATE_VP8_FFPROBE-yes)
+fate-vp8: $(FATE_VP8-yes) $(FATE_VP8_FFPROBE-yes)
 
 define FATE_VP9_SUITE
 FATE_VP9-$(CONFIG_MATROSKA_DEMUXER) += fate-vp9$(2)-$(1)
@@ -168,5 +184,12 @@ FATE_SAMPLES_DUMP_DATA += fate-vp9-encparams
 
 FATE_VP9-$(CONFIG_MATROSKA_DEMUXER) += fate-vp9-encparams
 
+# 2-pass encode with alt-ref frames, to cover the compound blocks exported
+# as two past vectors (source -1) with the BIPRED flag
+fate-vp9-mvs: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs -show_motion_vectors -of compact $(TARGET_SAMPLES)/vp9-test-vectors/vp90-2-2pass-akiyo.webm | do_md5sum - | cut -d " " -f1
+fate-vp9-mvs-ext: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -v 0 -export_side_data +mvs_ext -show_motion_vectors -of compact $(TARGET_SAMPLES)/vp9-test-vectors/vp90-2-2pass-akiyo.webm | do_md5sum - | cut -d " " -f1
+FATE_VP9_FFPROBE-$(call DEMDEC, MATROSKA, VP9) += fate-vp9-mvs fate-vp9-mvs-ext
+
 FATE_SAMPLES_AVCONV-$(CONFIG_VP9_DECODER) += $(FATE_VP9-yes)
-fate-vp9: $(FATE_VP9-yes)
+FATE_SAMPLES_FFPROBE += $(FATE_VP9_FFPROBE-yes)
+fate-vp9: $(FATE_VP9-yes) $(FATE_VP9_FFPROBE-yes)